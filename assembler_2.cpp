@@ -3,16 +3,67 @@
 #include <sstream>
 #include <string>
 #include <map>
+#include <set>
 #include <cstdlib>
 #include <algorithm>
 #include <vector>
+#include <cctype>
+#include <cstdio>
 using namespace std;
 
+// ลำดับ field ของ Instruction (ใช้เป็น index ของ columns)
+enum Field { FIELD_LABEL, FIELD_OPCODE, FIELD_ARG0, FIELD_ARG1, FIELD_ARG2 };
+
 // โครงสร้างข้อมูลสำหรับ 1 บรรทัด assembly
 struct Instruction {
     string label, opcode, arg0, arg1, arg2;
+    vector<string> params;  // argument ทั้งหมดของ .macro (ชื่อ macro + parameter)
+    int line = 0;           // บรรทัดในไฟล์ต้นฉบับ (เริ่มที่ 1, 0 = ไม่รู้)
+    int columns[5] = {};    // คอลัมน์ของแต่ละ Field (เริ่มที่ 1, 0 = ไม่มี)
+
+    Instruction() = default;
+    Instruction(const string &label, const string &opcode, const string &arg0,
+                const string &arg1, const string &arg2)
+        : label(label), opcode(opcode), arg0(arg0), arg1(arg1), arg2(arg2) {}
+};
+
+// ตัวเก็บ error ของ assembler: เก็บทุก error ไว้แล้วทำงานต่อ เพื่อให้เห็นปัญหาทั้งหมดในการรันครั้งเดียว
+// report() แสดงเรียงตามบรรทัดในรูปแบบ file:line:col: error: ... (ถ้ามี error จะไม่เขียนไฟล์ผลลัพธ์)
+struct Diagnostics {
+    struct Entry {
+        int line, column;
+        string message;
+    };
+    string file;
+    vector<Entry> entries;
+
+    void error(int line, int column, const string &message) {
+        entries.push_back({line, column, message});
+    }
+
+    void error(const Instruction &inst, Field field, const string &message) {
+        error(inst.line, inst.columns[field] ? inst.columns[field] : inst.columns[FIELD_OPCODE], message);
+    }
+
+    int errors() const { return (int)entries.size(); }
+
+    void report() const {
+        vector<Entry> sorted = entries;
+        stable_sort(sorted.begin(), sorted.end(), [](const Entry &a, const Entry &b) {
+            return a.line != b.line ? a.line < b.line : a.column < b.column;
+        });
+        for (const Entry &entry : sorted) {
+            cerr << file;
+            if (entry.line > 0) cerr << ":" << entry.line;
+            if (entry.line > 0 && entry.column > 0) cerr << ":" << entry.column;
+            cerr << ": error: " << entry.message << endl;
+        }
+        cerr << errors() << (errors() == 1 ? " error" : " errors") << " generated" << endl;
+    }
 };
 
+Diagnostics diag;
+
 
 // ฟังก์ชันไว้ตรวจสอบว่า string เป็นตัวเลขทั้งหมดหรือไม่
 // ใช้เพื่อแยกว่า argument เป็น immediate หรือ label
@@ -30,154 +81,810 @@ int convertNum(int num) {
     return num;
 }
 
-// ฟังก์ชันสำหรับอ่านและแยกคำสั่ง Assembly ทีละบรรทัด ทำหน้าที่:
-// 1.อ่านข้อความจากไฟล์ 1 บรรทัด
-// 2.ตัดส่วนที่เป็นคอมเมนต์ออก (หลังเครื่องหมาย ';')
-// 3.แยกข้อความออกเป็นคำ ๆ (label, opcode, และ argument ต่าง ๆ)
-// 4.เก็บผลลัพธ์ลงในโครงสร้าง Instruction
-int readAndParse(ifstream &inFile, Instruction &inst) {
-    string line;
-    if (!getline(inFile, line)) return 0;   // end of file
+// ฟังก์ชันสร้างชื่อไฟล์ที่เขียนไว้ข้างไฟล์ machine code โดยเปลี่ยนนามสกุล
+// เช่น "machine_code/machine_code.txt" → "machine_code/machine_code.sym"
+// simulator ใช้ชื่อเดียวกันนี้ในการหาไฟล์ symbol (.sym) และ source map (.map)
+string sideFileName(const string &machineFile, const string &extension) {
+    size_t dot = machineFile.find_last_of('.');
+    size_t slash = machineFile.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return machineFile + extension;
+    return machineFile.substr(0, dot) + extension;
+}
+
+string symbolFileName(const string &machineFile) {
+    return sideFileName(machineFile, ".sym");
+}
+
+string sourceMapFileName(const string &machineFile) {
+    return sideFileName(machineFile, ".map");
+}
+
+// ฟังก์ชันเขียน symbol table ลงไฟล์ (หนึ่งบรรทัดต่อ label: "ชื่อ address")
+// เรียงตาม address เพื่อให้ debugger อ่านแล้วใช้ทำ disassembly ได้ทันที
+void writeSymbolFile(const string &fileName, const map<string, int> &symbolTable) {
+    ofstream symFile(fileName);
+    if (!symFile.is_open()) {
+        cerr << "error opening " << fileName << endl;
+        exit(1);
+    }
+
+    vector<pair<int, string>> byAddress;
+    for (const auto &entry : symbolTable)
+        byAddress.push_back({entry.second, entry.first});
+    sort(byAddress.begin(), byAddress.end());
+
+    for (const auto &entry : byAddress)
+        symFile << entry.second << " " << entry.first << endl;
+}
+
+// ฟังก์ชันเขียน source map (address → บรรทัดในไฟล์ assembly) ลงไฟล์
+// บรรทัดแรก: "source <ไฟล์ assembly> <จำนวน word>"
+// บรรทัดต่อไป: "address line step" = ตั้งแต่ address นี้ บรรทัดเพิ่มทีละ step (0 หรือ 1) ต่อ word
+// โค้ดทั่วไปเป็น 1 word ต่อบรรทัด ทั้งโปรแกรมจึงมักเหลือไม่กี่แถว (แถวใหม่เฉพาะตรงที่ข้ามบรรทัด/ขยาย macro)
+void writeSourceMap(const string &fileName, const string &sourceName,
+                    const vector<Instruction> &instructions) {
+    ofstream mapFile(fileName);
+    if (!mapFile.is_open()) {
+        cerr << "error opening " << fileName << endl;
+        exit(1);
+    }
+
+    mapFile << "source " << sourceName << " " << instructions.size() << endl;
+    int start = 0, step = -1;
+    for (int i = 0; i < (int)instructions.size(); i++) {
+        int line = instructions[i].line;
+        int expected = instructions[start].line + (i - start) * max(step, 0);
+        if (i > start && step < 0 && (line == expected || line == expected + 1)) {
+            step = line - expected;
+            continue;
+        }
+        if (i > start && line == expected) continue;
+        if (i > start) mapFile << start << " " << instructions[start].line << " " << max(step, 0) << endl;
+        start = i;
+        step = -1;
+    }
+    if (!instructions.empty())
+        mapFile << start << " " << instructions[start].line << " " << max(step, 0) << endl;
+}
+
+// ฟังก์ชันเขียน machine code เป็น header ของ C++ (constexpr std::array)
+// ใช้กับ specialized_simulator.cpp ที่ให้ compiler รู้ทุกคำสั่งของโปรแกรมตั้งแต่ตอนคอมไพล์
+void writeProgramHeader(const string &fileName, const string &sourceName, const vector<int> &image) {
+    ofstream header(fileName);
+    if (!header.is_open()) {
+        cerr << "error opening " << fileName << endl;
+        exit(1);
+    }
+
+    header << "// generated by assembler_2 -H from " << sourceName << " -- do not edit\n";
+    header << "#pragma once\n#include <array>\n\n";
+    header << "constexpr std::array<int, " << image.size() << "> PROGRAM = {\n";
+    for (size_t i = 0; i < image.size(); i++)
+        header << "    " << image[i] << (i + 1 < image.size() ? "," : "") << "\n";
+    header << "};\n";
+}
+
+// relocation ของ object file: word ที่ address ต้องแทนด้วย address ของ symbol ตอน link
+struct Relocation {
+    int address;
+    string kind;    // "fill" = ทั้ง word (.fill label), "offset" = 16 บิตล่าง (lw/sw/swap label)
+    string symbol;
+};
+
+// ฟังก์ชันเขียน object file (assembler_2 -c) สำหรับ linker.cpp
+// บรรทัดแรก: "LC2KOBJ <จำนวน word> <จำนวน symbol> <จำนวน relocation>"
+// ตามด้วย machine code หนึ่ง word ต่อบรรทัด (field ที่ต้อง relocate ใส่ address ภายใน module ไว้ก่อน)
+// symbol: "ชื่อ D address" = export (.global), "ชื่อ L address" = label ภายใน module, "ชื่อ U 0" = import
+// relocation: "address fill|offset ชื่อ symbol"
+void writeObjectFile(const string &fileName, const vector<int> &image,
+                     const map<string, int> &symbolTable, const set<string> &exports,
+                     const set<string> &imports, const vector<Relocation> &relocations) {
+    ofstream objFile(fileName);
+    if (!objFile.is_open()) {
+        cerr << "error opening " << fileName << endl;
+        exit(1);
+    }
+
+    objFile << "LC2KOBJ " << image.size() << " " << symbolTable.size() + imports.size()
+            << " " << relocations.size() << endl;
+    for (int word : image) objFile << word << endl;
+    for (const auto &entry : symbolTable)
+        objFile << entry.first << (exports.count(entry.first) ? " D " : " L ") << entry.second << endl;
+    for (const string &name : imports) objFile << name << " U 0" << endl;
+    for (const Relocation &reloc : relocations)
+        objFile << reloc.address << " " << reloc.kind << " " << reloc.symbol << endl;
+}
+
+// โครงสร้างข้อมูลของ macro ที่ประกาศด้วย .macro ... .endm
+struct Macro {
+    vector<string> params;  // ชื่อ parameter (ในตัว macro อ้างถึงด้วย \ชื่อ)
+    vector<string> body;    // บรรทัดดิบของตัว macro (ยังไม่แทนค่า)
+};
+
+map<string, Macro> macros;  // macro ทั้งหมดที่ประกาศไว้ในไฟล์
+int macroExpansions = 0;    // ตัวนับจำนวนครั้งที่ขยาย macro (ใช้แทน \@ เพื่อให้ label ไม่ซ้ำ)
+
+// --- รายชื่อ opcode ที่รองรับ (รวม directive และ pseudo-op) ---
+const vector<string> OPCODES = {
+    "add", "nand", "lw", "sw", "beq", "jalr", "halt", "noop", "swap", ".fill",
+    ".macro", ".endm", ".pool", ".global",
+    "li", "push", "pop", "and", "call", "ret"
+};
+
+// ตรวจว่าคำนี้เป็น opcode / directive / pseudo-op / ชื่อ macro หรือไม่
+bool isOpcode(const string &word) {
+    return find(OPCODES.begin(), OPCODES.end(), word) != OPCODES.end()
+        || macros.count(word);
+}
+
+// ฟังก์ชันแยกข้อความ 1 บรรทัดเป็นคำสั่ง ทำหน้าที่:
+// 1.ตัดส่วนที่เป็นคอมเมนต์ออก (หลังเครื่องหมาย ';')
+// 2.แยกข้อความออกเป็นคำ ๆ (label, opcode, และ argument ต่าง ๆ)
+// 3.เก็บผลลัพธ์ลงในโครงสร้าง Instruction
+void parseLine(string line, Instruction &inst) {
     inst = {"", "", "", "", ""};            // เคลียร์ค่าเก่า
 
     // --- ลบคอมเมนต์ (เริ่มจาก ';') ---
     size_t pos = line.find(';');
     if (pos != string::npos) line = line.substr(0, pos);
 
-    // --- แยก token ด้วยช่องว่าง ---
-    stringstream ss(line);
+    // --- แยก token ด้วยช่องว่าง พร้อมจำคอลัมน์ของแต่ละ token (ใช้ตอนแสดง error) ---
     vector<string> parts;
-    string temp;
-    while (ss >> temp) parts.push_back(temp);
-
-    if (parts.empty()) return 1; // บรรทัดว่าง → ข้ามได้
+    vector<int> starts;
+    for (size_t i = 0; i < line.size(); ) {
+        if (isspace((unsigned char)line[i])) { i++; continue; }
+        size_t start = i;
+        while (i < line.size() && !isspace((unsigned char)line[i])) i++;
+        parts.push_back(line.substr(start, i - start));
+        starts.push_back((int)start + 1);
+    }
 
-    // --- รายชื่อ opcode ที่รองรับ ---
-    const vector<string> OPCODES = {
-        "add", "nand", "lw", "sw", "beq", "jalr", "halt", "noop", ".fill"
-    };
+    if (parts.empty()) return; // บรรทัดว่าง → ข้ามได้
 
     // --- ถ้าคำแรกเป็น opcode → ไม่มี label ---
-    if (find(OPCODES.begin(), OPCODES.end(), parts[0]) != OPCODES.end()) {
-        inst.label = "";
-        inst.opcode = parts[0];
-        if (parts.size() > 1) inst.arg0 = parts[1];
-        if (parts.size() > 2) inst.arg1 = parts[2];
-        if (parts.size() > 3) inst.arg2 = parts[3];
-    }
-    // --- ถ้าไม่ใช่ opcode แสดงว่าคำแรกคือ label ---
-    else {
+    size_t first = isOpcode(parts[0]) ? 0 : 1;
+    if (first == 1) {
         inst.label = parts[0];
-        if (parts.size() > 1) inst.opcode = parts[1];
-        if (parts.size() > 2) inst.arg0 = parts[2];
-        if (parts.size() > 3) inst.arg1 = parts[3];
-        if (parts.size() > 4) inst.arg2 = parts[4];
+        inst.columns[FIELD_LABEL] = starts[0];
+    }
+    string *fields[] = {&inst.opcode, &inst.arg0, &inst.arg1, &inst.arg2};
+    for (size_t f = 0; f < 4 && first + f < parts.size(); f++) {
+        *fields[f] = parts[first + f];
+        inst.columns[FIELD_OPCODE + f] = starts[first + f];
     }
 
+    // .macro มี parameter ได้หลายตัว เก็บทั้งหมดไว้
+    if (inst.opcode == ".macro")
+        inst.params.assign(parts.begin() + first + 1, parts.end());
+}
+
+// ฟังก์ชันสำหรับอ่านและแยกคำสั่ง Assembly ทีละบรรทัดจากไฟล์
+// lineNumber นับบรรทัดที่อ่านไปแล้ว (ใช้บอกตำแหน่งตอนแสดง error และเขียน source map)
+int readAndParse(ifstream &inFile, Instruction &inst, int &lineNumber) {
+    string line;
+    if (!getline(inFile, line)) return 0;   // end of file
+    parseLine(line, inst);
+    inst.line = ++lineNumber;
     return 1;
 }
 
+// อ่านตัว macro จากไฟล์ตั้งแต่บรรทัดถัดจาก .macro จนถึง .endm
+void defineMacro(ifstream &inFile, const Instruction &header, int &lineNumber) {
+    Macro macro;
+    if (header.params.size() > 1)
+        macro.params.assign(header.params.begin() + 1, header.params.end());
+    if (header.params.empty())
+        diag.error(header, FIELD_OPCODE, ".macro without name");
+    else if (macro.params.size() > 3)
+        diag.error(header, FIELD_ARG0, "macro " + header.params[0] + " has more than 3 parameters");
+
+    string line;
+    Instruction inst;
+    while (getline(inFile, line)) {
+        lineNumber++;
+        parseLine(line, inst);
+        if (inst.opcode == ".endm") {
+            if (!header.params.empty()) macros[header.params[0]] = macro;
+            return;
+        }
+        macro.body.push_back(line);
+    }
+    diag.error(header, FIELD_OPCODE, "missing .endm for macro "
+               + (header.params.empty() ? string("") : header.params[0]));
+}
+
+// constant pool: เก็บค่าคงที่ที่ใช้ผ่าน li / =ค่า / call
+// ค่าเดียวกันใช้ .fill ร่วมกันแค่ word เดียว
+// .fill ของแต่ละค่าจำตำแหน่งในไฟล์ของที่ที่ใช้ครั้งแรก ไว้บอกตำแหน่งเมื่อค่านั้นผิด (เช่น label ไม่มีจริง)
+struct ConstantPool {
+    map<string, string> labels;             // ค่า → ชื่อ label ของ .fill
+    vector<Instruction> entries;            // .fill เรียงตามลำดับที่ใช้ครั้งแรก
+
+    string labelFor(string value, const Instruction &site, Field field) {
+        if (isNumber(value)) value = to_string(strtoll(value.c_str(), nullptr, 10));  // "01" กับ "1" เป็นค่าเดียวกัน
+        auto it = labels.find(value);
+        if (it != labels.end()) return it->second;
+        string label = "__pool" + to_string(entries.size());
+        labels[value] = label;
+        Instruction fill = {label, ".fill", value, "", ""};
+        fill.line = site.line;
+        fill.columns[FIELD_ARG0] = site.columns[field] ? site.columns[field] : site.columns[FIELD_OPCODE];
+        entries.push_back(fill);
+        return label;
+    }
+};
+
+// ค่า default ของ argument ที่ไม่ระบุ (เช่น register ของ stack pointer)
+string argOr(const string &arg, const string &fallback) {
+    return arg.empty() ? fallback : arg;
+}
+
+// คำสั่งที่ได้จากการขยาย macro / pseudo-op ใช้ตำแหน่งของบรรทัดที่เรียกใช้ (ทุก field ชี้ไปที่ opcode)
+void placeAt(Instruction &inst, const Instruction &site) {
+    inst.line = site.line;
+    for (int &column : inst.columns) column = site.columns[FIELD_OPCODE];
+}
+
+// ขยาย macro และ pseudo-op ให้เหลือแต่คำสั่งจริงของ LC-2K
+// pseudo-op ที่รองรับ (sp = stack pointer, tmp = register ชั่วคราว, ra = return address):
+//   li   reg value          → lw 0 reg <pool value>
+//   push reg [sp=5] [one=6] → sw sp reg stack ; add sp one sp    (register one ต้องมีค่า 1 อยู่แล้ว)
+//   pop  reg [sp=5] [neg=4] → add sp neg sp ; lw sp reg stack    (register neg ต้องมีค่า -1 อยู่แล้ว)
+//     ตั้ง ±1 ไว้ครั้งเดียว (เช่น li 6 1 / li 4 -1) แบบเดียวกับที่เขียนมือใน Combination.txt
+//     push/pop จึงเหลือ 2 word ไม่ต้องโหลดค่าคงที่ทุกครั้ง
+//   and  a b dest           → nand a b dest ; nand dest dest dest
+//   call label [ra=7] [tmp=3] → lw 0 tmp <pool label> ; jalr tmp ra
+//   ret  [ra=7] [tmp=2]     → jalr ra tmp
+//     tmp ค่าเริ่มต้นไม่ชนกับ register ที่ push/pop ใช้ (4-7): call ทับ r3 ที่ callee จะเขียนผลลัพธ์ทับอยู่แล้ว
+//     ret ทับ r2 แทนเพราะ r3 ถือผลลัพธ์อยู่
+//   lw/sw ที่ offset เขียนเป็น =ค่า จะอ้างไปที่ค่านั้นใน constant pool
+void expandInstruction(const Instruction &inst, vector<Instruction> &out,
+                       ConstantPool &pool, int depth) {
+    vector<Instruction> expanded;
+    const string &op = inst.opcode;
+
+    if (macros.count(op)) {
+        if (depth > 64) {
+            diag.error(inst, FIELD_OPCODE, "macro expansion too deep in " + op);
+            return;
+        }
+        const Macro &macro = macros[op];
+        const string args[] = {inst.arg0, inst.arg1, inst.arg2};
+        if (macro.params.size() > 3) return;    // แจ้ง error ไปแล้วตอนประกาศ macro
+        string counter = to_string(macroExpansions++);
+        for (string line : macro.body) {
+            // แทน \param ด้วย argument และ \@ ด้วยตัวนับ (ชื่อยาวก่อน เพื่อไม่ให้ \a ไปทับ \ab)
+            vector<size_t> order(macro.params.size());
+            for (size_t i = 0; i < order.size(); i++) order[i] = i;
+            sort(order.begin(), order.end(), [&](size_t x, size_t y) {
+                return macro.params[x].size() > macro.params[y].size();
+            });
+            for (size_t i : order) {
+                string key = "\\" + macro.params[i];
+                for (size_t pos; (pos = line.find(key)) != string::npos; )
+                    line.replace(pos, key.size(), args[i]);
+            }
+            for (size_t pos; (pos = line.find("\\@")) != string::npos; )
+                line.replace(pos, 2, counter);
+
+            Instruction bodyInst;
+            parseLine(line, bodyInst);
+            if (bodyInst.label.empty() && bodyInst.opcode.empty()) continue;
+            placeAt(bodyInst, inst);
+            expandInstruction(bodyInst, expanded, pool, depth + 1);
+        }
+    }
+    else if (op == "li")
+        expanded.push_back({"", "lw", "0", inst.arg0, pool.labelFor(inst.arg1, inst, FIELD_ARG1)});
+    else if (op == "push") {
+        string sp = argOr(inst.arg1, "5"), one = argOr(inst.arg2, "6");
+        expanded.push_back({"", "sw", sp, inst.arg0, "stack"});
+        expanded.push_back({"", "add", sp, one, sp});
+    }
+    else if (op == "pop") {
+        string sp = argOr(inst.arg1, "5"), neg = argOr(inst.arg2, "4");
+        expanded.push_back({"", "add", sp, neg, sp});
+        expanded.push_back({"", "lw", sp, inst.arg0, "stack"});
+    }
+    else if (op == "and") {
+        expanded.push_back({"", "nand", inst.arg0, inst.arg1, inst.arg2});
+        expanded.push_back({"", "nand", inst.arg2, inst.arg2, inst.arg2});
+    }
+    else if (op == "call") {
+        string ra = argOr(inst.arg1, "7"), tmp = argOr(inst.arg2, "3");
+        expanded.push_back({"", "lw", "0", tmp, pool.labelFor(inst.arg0, inst, FIELD_ARG0)});
+        expanded.push_back({"", "jalr", tmp, ra, ""});
+    }
+    else if (op == "ret")
+        expanded.push_back({"", "jalr", argOr(inst.arg0, "7"), argOr(inst.arg1, "2"), ""});
+    else {
+        Instruction copy = inst;
+        copy.label = "";
+        if ((op == "lw" || op == "sw") && copy.arg2.size() > 1 && copy.arg2[0] == '=')
+            copy.arg2 = pool.labelFor(copy.arg2.substr(1), inst, FIELD_ARG2);
+        expanded.push_back(copy);
+    }
+
+    // คำสั่งที่สร้างจาก pseudo-op ยังไม่มีตำแหน่ง (คำสั่งจาก macro และคำสั่งจริงมีแล้ว)
+    for (Instruction &e : expanded)
+        if (e.line == 0) placeAt(e, inst);
+
+    // label หน้าคำสั่งที่ถูกขยาย ให้ชี้ไปที่คำสั่งแรกของผลลัพธ์
+    if (!inst.label.empty()) {
+        if (expanded.empty() || !expanded[0].label.empty()) {
+            diag.error(inst, FIELD_LABEL, "label " + inst.label + " cannot be attached to " + op);
+            return;
+        }
+        expanded[0].label = inst.label;
+        expanded[0].columns[FIELD_LABEL] = inst.columns[FIELD_LABEL];
+    }
+    out.insert(out.end(), expanded.begin(), expanded.end());
+}
+
+// operand ที่เป็น register ต้องเป็นเลข 0-7
+bool isRegister(const string &s) {
+    return isNumber(s) && strtol(s.c_str(), nullptr, 10) >= 0 && strtol(s.c_str(), nullptr, 10) <= 7;
+}
+
+// เลข register ของ operand (ที่ผ่าน checkOperands แล้ว) ถ้าผิดคืน 0 เพื่อให้ PASS 2 ทำงานต่อได้
+int registerNumber(const string &s) {
+    return isRegister(s) ? stoi(s) : 0;
+}
+
+// ตรวจ opcode และจำนวน/ชนิดของ operand ของคำสั่งจริง (หลังขยาย macro / pseudo-op แล้ว)
+// แจ้ง error ทุกจุดที่พบ คืนค่า false ถ้ามีอย่างน้อยหนึ่งจุด
+bool checkOperands(const Instruction &inst) {
+    const string &op = inst.opcode;
+    int registers;
+    bool needsOffset = false;
+    if (op == "add" || op == "nand") registers = 3;
+    else if (op == "lw" || op == "sw" || op == "beq" || op == "swap") registers = 2, needsOffset = true;
+    else if (op == "jalr") registers = 2;
+    else if (op == "halt" || op == "noop") registers = 0;
+    else if (op == ".fill") {
+        if (inst.arg0.empty()) {
+            diag.error(inst, FIELD_OPCODE, "missing value for .fill");
+            return false;
+        }
+        return true;
+    }
+    else if (op.empty()) {
+        diag.error(inst, FIELD_LABEL, "missing opcode after label " + inst.label);
+        return false;
+    }
+    else {
+        diag.error(inst, FIELD_OPCODE, "unrecognized opcode " + op);
+        return false;
+    }
+
+    bool ok = true;
+    const string *args[] = {&inst.arg0, &inst.arg1, &inst.arg2};
+    for (int i = 0; i < registers; i++) {
+        Field field = (Field)(FIELD_ARG0 + i);
+        if (args[i]->empty()) {
+            diag.error(inst, FIELD_OPCODE, "missing register operand for " + op);
+            return false;
+        }
+        if (!isRegister(*args[i])) {
+            diag.error(inst, field, "invalid register " + *args[i] + " (expected 0-7)");
+            ok = false;
+        }
+    }
+    if (needsOffset && inst.arg2.empty()) {
+        diag.error(inst, FIELD_OPCODE, "missing offset for " + op);
+        ok = false;
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------
+// Peephole optimizer (เปิดด้วย -O) ทำงานกับ vector<Instruction> หลัง PASS 1
+// ยังใช้ชื่อ label อยู่ จึงคำนวณ address และ offset ของ beq ใหม่ได้ใน PASS 2 ตามปกติ
+// ---------------------------------------------------------------------
+
+struct OptimizeReport {
+    int noopsRemoved = 0;
+    int deadStores = 0;
+    int loadsHoisted = 0;
+    int wordsBefore = 0;
+    int wordsAfter = 0;
+    int savedPerIteration = 0;  // จำนวนคำสั่งที่ลดลงต่อรอบของ loop (ประมาณการ dynamic)
+    int savedOnce = 0;          // คำสั่งที่ลดลงนอก loop (รันครั้งเดียว)
+};
+
+// register ที่คำสั่งอ่าน/เขียน (-1 = ไม่มี)
+void regUsage(const Instruction &inst, int reads[2], int &writes) {
+    reads[0] = reads[1] = writes = -1;
+    const string &op = inst.opcode;
+    if (op == "add" || op == "nand") {
+        reads[0] = stoi(inst.arg0); reads[1] = stoi(inst.arg1); writes = stoi(inst.arg2);
+    } else if (op == "lw" || op == "jalr") {
+        reads[0] = stoi(inst.arg0); writes = stoi(inst.arg1);
+    } else if (op == "sw" || op == "beq") {
+        reads[0] = stoi(inst.arg0); reads[1] = stoi(inst.arg1);
+    } else if (op == "swap") {
+        reads[0] = stoi(inst.arg0); reads[1] = stoi(inst.arg1); writes = stoi(inst.arg1);
+    }
+}
+
+// operand ที่เป็นชื่อ label (arg2 ของ lw/sw/beq/swap หรือ arg0 ของ .fill) ถ้าไม่ใช่คืนค่า nullptr
+string *labelOperand(Instruction &inst) {
+    const string &op = inst.opcode;
+    string *arg = nullptr;
+    if (op == "lw" || op == "sw" || op == "beq" || op == "swap") arg = &inst.arg2;
+    else if (op == ".fill") arg = &inst.arg0;
+    return (arg && !arg->empty() && !isNumber(*arg)) ? arg : nullptr;
+}
+
+// คืนค่าตำแหน่งของ label ทุกตัว
+map<string, int> labelIndex(const vector<Instruction> &code) {
+    map<string, int> index;
+    for (int i = 0; i < (int)code.size(); i++)
+        if (!code[i].label.empty()) index[code[i].label] = i;
+    return index;
+}
+
+// ช่วงของ loop = [ปลายทางของ beq ย้อนกลับ, ตำแหน่ง beq นั้น]
+vector<pair<int, int>> findLoops(const vector<Instruction> &code) {
+    map<string, int> index = labelIndex(code);
+    vector<pair<int, int>> loops;
+    for (int j = 0; j < (int)code.size(); j++) {
+        if (code[j].opcode != "beq" || !index.count(code[j].arg2)) continue;
+        int t = index[code[j].arg2];
+        if (t <= j) loops.push_back({t, j});
+    }
+    return loops;
+}
+
+bool inAnyLoop(const vector<pair<int, int>> &loops, int i) {
+    for (const auto &loop : loops)
+        if (loop.first <= i && i <= loop.second) return true;
+    return false;
+}
+
+// ลบคำสั่งที่ถูก mark ไว้ label ของคำสั่งที่ถูกลบจะย้ายไปที่คำสั่งถัดไป
+// ถ้าคำสั่งถัดไปมี label อยู่แล้ว จะเปลี่ยนทุกการอ้างถึง label เก่าไปเป็น label ใหม่แทน
+vector<Instruction> removeMarked(const vector<Instruction> &code, const vector<bool> &remove) {
+    vector<Instruction> out;
+    map<string, string> rename;
+    vector<string> pending;
+    for (int i = 0; i < (int)code.size(); i++) {
+        if (remove[i]) {
+            if (!code[i].label.empty()) pending.push_back(code[i].label);
+            continue;
+        }
+        Instruction inst = code[i];
+        if (!pending.empty()) {
+            if (inst.label.empty()) inst.label = pending[0];
+            for (const string &old : pending)
+                if (old != inst.label) rename[old] = inst.label;
+            pending.clear();
+        }
+        out.push_back(inst);
+    }
+    for (Instruction &inst : out) {
+        string *arg = labelOperand(inst);
+        if (arg && rename.count(*arg)) *arg = rename[*arg];
+    }
+    return out;
+}
+
+// ย้าย lw ค่าคงที่ (lw 0 R label ของ .fill ที่ไม่มี sw เขียนทับ) ออกไปไว้หน้า loop
+// เงื่อนไข: ไม่มีการกระโดดเข้ากลาง loop จากข้างนอก, ไม่มี jalr/halt ใน loop,
+// ไม่มี sw/swap ใน loop ที่เขียนผ่าน register (base ไม่ใช่ r0) หรือ address ตัวเลข (อาจเขียนทับ .fill ใดก็ได้),
+// R ไม่ถูกเขียนที่อื่นใน loop และไม่ถูกอ่านก่อนถึง lw, และทุกเส้นทางในรอบแรกต้องผ่าน lw
+bool hoistOneLoad(vector<Instruction> &code) {
+    map<string, int> index = labelIndex(code);
+    set<string> written;            // label ที่มี sw/swap เขียนถึงโดยตรง
+    for (const Instruction &inst : code)
+        if (inst.opcode == "sw" || inst.opcode == "swap") written.insert(inst.arg2);
+
+    for (const auto &loop : findLoops(code)) {
+        int t = loop.first, j = loop.second;
+
+        bool safe = true;
+        for (int k = 0; k < (int)code.size() && safe; k++) {
+            const Instruction &inst = code[k];
+            bool inside = (t <= k && k <= j);
+            if (inside && (inst.opcode == "jalr" || inst.opcode == "halt" || inst.opcode == ".fill"))
+                safe = false;
+            if (inside && (inst.opcode == "sw" || inst.opcode == "swap")
+                && (inst.arg0 != "0" || isNumber(inst.arg2)))
+                safe = false;
+            if (!inside && (inst.opcode == "beq" || inst.opcode == ".fill") && index.count(inst.opcode == "beq" ? inst.arg2 : inst.arg0)) {
+                int target = index[inst.opcode == "beq" ? inst.arg2 : inst.arg0];
+                if (t <= target && target <= j) safe = false;     // มีทางเข้าจากนอก loop
+            }
+        }
+        if (!safe) continue;
+
+        for (int p = t; p < j; p++) {
+            const Instruction &cand = code[p];
+            if (cand.opcode != "lw" || cand.arg0 != "0" || !index.count(cand.arg2)) continue;
+            int data = index[cand.arg2];
+            if (code[data].opcode != ".fill" || written.count(cand.arg2)) continue;
+
+            int reg = stoi(cand.arg1);
+            bool ok = true;
+            for (int k = t; k <= j && ok; k++) {
+                if (k == p) continue;
+                int reads[2], writes;
+                regUsage(code[k], reads, writes);
+                if (writes == reg) ok = false;
+                if (k < p && (reads[0] == reg || reads[1] == reg)) ok = false;
+                if (k < p && code[k].opcode == "beq") {
+                    int target = index.count(code[k].arg2) ? index[code[k].arg2] : -1;
+                    if (target < t || target > p) ok = false;
+                }
+            }
+            if (!ok) continue;
+
+            Instruction hoisted = cand;
+            hoisted.label = code[p].label;
+            code.erase(code.begin() + p);
+            if (!hoisted.label.empty()) {
+                // label ของ lw เดิมย้ายไปอยู่กับคำสั่งถัดไปใน loop
+                if (code[p].label.empty()) code[p].label = hoisted.label;
+                else {
+                    for (Instruction &inst : code) {
+                        string *arg = labelOperand(inst);
+                        if (arg && *arg == hoisted.label) *arg = code[p].label;
+                    }
+                }
+                hoisted.label = "";
+            }
+            code.insert(code.begin() + t, hoisted);
+            return true;
+        }
+    }
+    return false;
+}
+
+OptimizeReport optimize(vector<Instruction> &code) {
+    OptimizeReport report;
+    report.wordsBefore = (int)code.size();
+
+    // beq ที่ใช้ offset เป็นตัวเลข → แปลงเป็น label ก่อน เพื่อให้ offset ถูกต้องหลังลบคำสั่ง
+    // lw/sw ที่ใช้ address เป็นตัวเลข (ไม่ใช่ 0) อ้างตำแหน่งตายตัว ลบคำสั่งไม่ได้
+    bool canRemove = true;
+    for (int i = 0; i < (int)code.size(); i++) {
+        Instruction &inst = code[i];
+        if (inst.opcode.empty()) {                          // มีบรรทัดว่าง ไม่ optimize
+            report.wordsAfter = report.wordsBefore;
+            return report;
+        }
+        // offset ตัวเลขอ่านด้วย strtoll (ค่าเกินช่วงจะถูกแจ้ง error ใน PASS 2 ไม่ใช่ที่นี่)
+        if ((inst.opcode == "lw" || inst.opcode == "sw" || inst.opcode == "swap")
+            && isNumber(inst.arg2) && strtoll(inst.arg2.c_str(), nullptr, 10) != 0)
+            canRemove = false;
+        if (inst.opcode == "beq" && isNumber(inst.arg2)) {
+            long long offset = strtoll(inst.arg2.c_str(), nullptr, 10);
+            long long target = i + 1 + max(-65536LL, min(offset, 65536LL));
+            if (target < 0 || target >= (int)code.size()) { canRemove = false; continue; }
+            if (code[target].label.empty()) code[target].label = "__L" + to_string(target);
+            inst.arg2 = code[target].label;
+        }
+    }
+
+    if (canRemove) {
+        vector<pair<int, int>> loops = findLoops(code);
+        vector<bool> remove(code.size(), false);
+        for (int i = 0; i + 1 < (int)code.size(); i++) {
+            // noop ไม่มีผลอะไร ถ้ามี label ก็ย้ายไปที่คำสั่งถัดไป
+            if (code[i].opcode == "noop") {
+                remove[i] = true;
+                report.noopsRemoved++;
+            }
+            // sw 0 R label ที่ถูก sw ไปที่ label เดิมซ้ำใน basic block เดียวกัน โดยไม่มีการอ่านคั่น
+            else if (code[i].opcode == "sw" && code[i].arg0 == "0") {
+                for (int k = i + 1; k < (int)code.size(); k++) {
+                    const Instruction &next = code[k];
+                    if (!next.label.empty() || next.opcode == "lw" || next.opcode == "beq"
+                        || next.opcode == "jalr" || next.opcode == "halt"
+                        || next.opcode == "swap" || next.opcode == ".fill")
+                        break;
+                    if (next.opcode == "sw" && next.arg0 == "0" && next.arg2 == code[i].arg2) {
+                        remove[i] = true;
+                        report.deadStores++;
+                        break;
+                    }
+                }
+            }
+            if (remove[i]) {
+                if (inAnyLoop(loops, i)) report.savedPerIteration++;
+                else report.savedOnce++;
+            }
+        }
+        code = removeMarked(code, remove);
+    }
+
+    // การย้าย lw ทำให้คำสั่งใน loop เลื่อนตำแหน่ง จึงทำได้เฉพาะเมื่อไม่มี address ตัวเลขเหมือนการลบคำสั่ง
+    for (int n = 0; canRemove && n < 100 && hoistOneLoad(code); n++) {
+        report.loadsHoisted++;
+        report.savedPerIteration++;
+    }
+
+    report.wordsAfter = (int)code.size();
+    return report;
+}
+
+void printOptimizeReport(const OptimizeReport &report) {
+    cout << "optimizer: removed " << report.noopsRemoved << " noop, "
+         << report.deadStores << " dead store, hoisted " << report.loadsHoisted << " load\n";
+    cout << "optimizer: " << report.wordsBefore << " -> " << report.wordsAfter << " words ("
+         << report.wordsBefore - report.wordsAfter << " saved)\n";
+    cout << "optimizer: estimated dynamic saving " << report.savedPerIteration
+         << " instructions per loop iteration + " << report.savedOnce << " once\n";
+}
+
 // ฟังก์ชันหลักของโปรแกรม Assembler
 // ทำหน้าที่แปลงไฟล์ Assembly ให้เป็น Machine Code
 // โดยใช้กระบวนการ 2 รอบ (2-pass):
 // Pass 1: อ่านไฟล์เพื่อเก็บตำแหน่งของ label แต่ละตัว
 // Pass 2: แปลงคำสั่งทั้งหมดเป็นตัวเลข 32 บิต แล้วเขียนลงไฟล์ผลลัพธ์
-void assembler(const string &inputFile, const string &outputFile) {
+// ถ้า optimizeCode = true จะรัน peephole optimizer ระหว่าง Pass 1 กับ Pass 2
+// ถ้าระบุ headerFile จะเขียน machine code เป็น constexpr header เพิ่มอีกไฟล์
+// error ทุกจุดจะแสดงเป็น file:line:col แล้วทำงานต่อจนจบ PASS 2 ถ้ามี error จะไม่เขียนไฟล์ผลลัพธ์
+// นอกจาก machine code จะเขียน symbol map (.sym) และ source map (.map) ไว้ข้างไฟล์ผลลัพธ์ด้วย
+// ถ้า objectFile = true จะเขียน object file ให้ linker แทน: label ที่ไม่ได้ประกาศในไฟล์นี้
+// ถือเป็น import และทุกการอ้าง label ของ .fill / lw / sw / swap จะมี relocation
+void assembler(const string &inputFile, const string &outputFile, bool optimizeCode = false,
+               const string &headerFile = "", bool objectFile = false) {
     // เปิดไฟล์ Assembly ที่จะอ่านข้อมูลเข้า (inputFile)
     ifstream inFile(inputFile);
         if (!inFile.is_open()) {                // ถ้าเปิดไฟล์ไม่ได้
             cerr << "error opening " << inputFile << endl;  // แสดงข้อความผิดพลาด
             exit(1);                            // และหยุดการทำงานทันที
         }
-
-    // เปิดไฟล์ผลลัพธ์สำหรับเขียน Machine Code (outputFile)
-    ofstream outFile(outputFile);
-        if (!outFile.is_open()) {               // ถ้าเปิดไฟล์ไม่ได้
-            cerr << "error opening " << outputFile << endl;
-            exit(1);
-        }
+    diag.file = inputFile;
 
     // สร้างตัวแปรที่ใช้ภายใน assembler
     map<string, int> symbolTable;           // ตารางเก็บชื่อ label และตำแหน่ง address ของมัน
     vector<Instruction> instructions;       // เก็บคำสั่ง Assembly ทั้งหมดในรูปแบบที่แยกส่วนแล้ว
     Instruction inst;                       // ตัวแปรชั่วคราวไว้ใช้ตอนอ่านแต่ละบรรทัด
     int address = 0;                        // ตัวนับตำแหน่งคำสั่ง (เริ่มจากบรรทัด 0)
+    int lineNumber = 0;                     // บรรทัดล่าสุดที่อ่านจากไฟล์
+    vector<Instruction> globals;            // .global ของไฟล์นี้ (symbol ที่ export ให้ module อื่น)
+    set<string> exports, imports;
+    vector<Relocation> relocations;
 
 
         // PASS 1 : สร้างตาราง symbol table
-        // ขั้นตอนนี้จะอ่านไฟล์ Assembly ทีละบรรทัด
-        // เพื่อเก็บชื่อ label และตำแหน่งบรรทัด (address) ของแต่ละคำสั่ง
+        // ขั้นตอนนี้จะอ่านไฟล์ Assembly ทีละบรรทัด ขยาย macro / pseudo-op ให้เป็นคำสั่งจริง
+        // แล้วเก็บชื่อ label และตำแหน่ง (address) ของแต่ละคำสั่ง
         // ข้อมูลเหล่านี้จะถูกนำไปใช้ใน PASS 2 ตอนแปลงเป็น machine code
-        while (readAndParse(inFile, inst)) {
+        ConstantPool pool;                  // ค่าคงที่ที่ pseudo-op ต้องใช้
+        int poolAddress = -1;               // ตำแหน่งของ .pool (ถ้าไม่มี จะต่อท้ายโปรแกรม)
+        while (readAndParse(inFile, inst, lineNumber)) {
+            if (inst.opcode == ".macro") {
+                defineMacro(inFile, inst, lineNumber);
+                continue;
+            }
+            if (inst.opcode == ".pool") {
+                // ใช้ .pool เมื่อมี stack โตต่อจากท้ายโปรแกรม เพื่อไม่ให้ทับค่าคงที่
+                if (!inst.label.empty() || poolAddress >= 0)
+                    diag.error(inst, FIELD_OPCODE, ".pool must appear once and without label");
+                else
+                    poolAddress = (int)instructions.size();
+                continue;
+            }
+            if (inst.opcode == ".global") {
+                // .global ไม่กินพื้นที่ใน memory ถ้า assemble เป็นโปรแกรมเต็ม (ไม่ใช้ -c) จะไม่มีผลอะไร
+                if (!inst.label.empty() || inst.arg0.empty())
+                    diag.error(inst, FIELD_OPCODE, ".global needs one label name and no label");
+                else
+                    globals.push_back(inst);
+                continue;
+            }
+            // บรรทัดว่าง / คอมเมนต์ล้วน ไม่นับเป็นคำสั่ง (ไม่ทำให้ address เลื่อน)
+            if (inst.label.empty() && inst.opcode.empty())
+                continue;
+            expandInstruction(inst, instructions, pool, 0);
+        }
+
+        // วาง constant pool เป็น .fill ที่ตำแหน่ง .pool
+        // ถ้าไม่มี .pool: วางก่อน label stack (push/pop เขียน stack โตขึ้นไปทาง address มาก จะทับ pool ที่อยู่หลัง stack)
+        // ถ้าไม่มี label stack ด้วย จึงวางท้ายโปรแกรม
+        if (poolAddress < 0) {
+            poolAddress = (int)instructions.size();
+            for (int i = 0; i < (int)instructions.size(); i++)
+                if (instructions[i].label == "stack") poolAddress = i;
+        }
+        instructions.insert(instructions.begin() + poolAddress, pool.entries.begin(), pool.entries.end());
+
+        // ตรวจ opcode / operand ก่อน optimizer (optimizer อ่านเลข register จึงต้องถูกต้องทั้งหมด)
+        for (const Instruction &expanded : instructions) checkOperands(expanded);
+
+        if (optimizeCode && diag.errors() == 0) printOptimizeReport(optimize(instructions));
+
+        for (const Instruction &expanded : instructions) {
             // ถ้าบรรทัดนี้มี label อยู่ข้างหน้า (เช่น "loop add 1 2 3")
-            if (!inst.label.empty()) {
+            if (!expanded.label.empty()) {
                 // ตรวจว่ามี label นี้อยู่ในตารางแล้วหรือยัง
-                // ถ้ามีซ้ำ → แสดง error แล้วหยุดการทำงาน
-                if (symbolTable.count(inst.label)) {
-                    cerr << "error: duplicate label " << inst.label << endl;
-                    exit(1);
+                // ถ้ามีซ้ำ → แจ้ง error แล้วใช้ตำแหน่งแรกต่อไป
+                if (symbolTable.count(expanded.label)) {
+                    diag.error(expanded, FIELD_LABEL, "duplicate label " + expanded.label);
+                    address++;
+                    continue;
                 }
                 // ถ้าไม่ซ้ำ → บันทึก label และตำแหน่งปัจจุบันลง symbol table
-                symbolTable[inst.label] = address; // เช่น "loop" → 3
+                symbolTable[expanded.label] = address; // เช่น "loop" → 3
             }
-            // เก็บคำสั่งทั้งหมด (รวม label, opcode, arg) ลงใน vector instructions
-            instructions.push_back(inst);
 
             // เพิ่ม address ทีละ 1 (นับจำนวนบรรทัดของคำสั่ง)
             address++;
         }
 
+        // symbol ที่ export ต้องเป็น label ที่ประกาศในไฟล์นี้
+        for (const Instruction &global : globals) {
+            if (!symbolTable.count(global.arg0))
+                diag.error(global, FIELD_ARG0, ".global of undefined label " + global.arg0);
+            exports.insert(global.arg0);
+        }
     
     // PASS 2 : แปลงแต่ละคำสั่งเป็น machine code
+    vector<int> image;                      // machine code ทั้งหมด (ใช้ตอนเขียน header)
     for (int i = 0; i < (int)instructions.size(); i++) {
         inst = instructions[i];
         int machineCode = 0; // เก็บผลลัพธ์เลข 32 บิต
 
         //---------- R-type ----------
         if (inst.opcode == "add")
-            machineCode = (0 << 22) | (stoi(inst.arg0) << 19)
-                        | (stoi(inst.arg1) << 16) | stoi(inst.arg2);
+            machineCode = (0 << 22) | (registerNumber(inst.arg0) << 19)
+                        | (registerNumber(inst.arg1) << 16) | registerNumber(inst.arg2);
 
         else if (inst.opcode == "nand")
-            machineCode = (1 << 22) | (stoi(inst.arg0) << 19)
-                        | (stoi(inst.arg1) << 16) | stoi(inst.arg2);
+            machineCode = (1 << 22) | (registerNumber(inst.arg0) << 19)
+                        | (registerNumber(inst.arg1) << 16) | registerNumber(inst.arg2);
 
         //---------- I-type ----------
-        else if (inst.opcode == "lw" || inst.opcode == "sw" || inst.opcode == "beq") {
+        // swap (คำสั่งเสริมสำหรับ multi-core) ใช้รูปแบบเดียวกับ lw/sw แต่ใช้ opcode 7 ร่วมกับ noop
+        else if (inst.opcode == "lw" || inst.opcode == "sw" || inst.opcode == "beq"
+                 || inst.opcode == "swap") {
             int opcodeNum = (inst.opcode == "lw") ? 2 :
-                            (inst.opcode == "sw") ? 3 : 4;
-            int offset;
+                            (inst.opcode == "sw") ? 3 :
+                            (inst.opcode == "beq") ? 4 : 7;
+            long long offset = 0;
 
             // ตรวจว่า arg2 เป็น immediate หรือ label
             if (isNumber(inst.arg2))
-                offset = stoi(inst.arg2);
+                offset = strtoll(inst.arg2.c_str(), nullptr, 10);
             else if (symbolTable.count(inst.arg2)) {
-                // beq ใช้ PC-relative offset
+                // beq ใช้ PC-relative offset (ไม่ต้อง relocate เพราะทั้ง module ย้ายไปพร้อมกัน)
                 offset = symbolTable[inst.arg2] - ((inst.opcode == "beq") ? (i + 1) : 0);
-            } else {
-                cerr << "error: undefined label " << inst.arg2 << endl;
-                exit(1);
+                if (objectFile && inst.opcode != "beq") relocations.push_back({i, "offset", inst.arg2});
+            } else if (objectFile && inst.opcode != "beq" && !inst.arg2.empty()) {
+                imports.insert(inst.arg2);
+                relocations.push_back({i, "offset", inst.arg2});
+            } else if (objectFile && inst.opcode == "beq") {
+                diag.error(inst, FIELD_ARG2, "beq target " + inst.arg2 + " must be defined in the same module");
+            } else if (!inst.arg2.empty()) {
+                diag.error(inst, FIELD_ARG2, "undefined label " + inst.arg2);
             }
 
             // ตรวจช่วงของ offset (-32768 ถึง 32767)
             if (offset < -32768 || offset > 32767) {
-                cerr << "error: offsetField out of range at line " << i << endl;
-                exit(1);
+                diag.error(inst, FIELD_ARG2, "offsetField " + to_string(offset)
+                           + " out of range (-32768 to 32767)");
+                offset = 0;
             }
 
-            offset &= 0xFFFF; // เก็บเฉพาะ 16 บิตล่าง
-
             machineCode = (opcodeNum << 22)
-                        | (stoi(inst.arg0) << 19)
-                        | (stoi(inst.arg1) << 16)
-                        | offset;
+                        | (registerNumber(inst.arg0) << 19)
+                        | (registerNumber(inst.arg1) << 16)
+                        | (int)(offset & 0xFFFF);  // เก็บเฉพาะ 16 บิตล่าง
+
+            // swap ที่ทุก field เป็นศูนย์จะกลายเป็น noop
+            if (machineCode == (7 << 22))
+                diag.error(inst, FIELD_OPCODE, "swap 0 0 0 encodes as noop");
         }
 
         //---------- J-type ----------
         else if (inst.opcode == "jalr")
             machineCode = (5 << 22)
-                        | (stoi(inst.arg0) << 19)
-                        | (stoi(inst.arg1) << 16);
+                        | (registerNumber(inst.arg0) << 19)
+                        | (registerNumber(inst.arg1) << 16);
 
         //---------- O-type ----------
         else if (inst.opcode == "halt")
@@ -188,38 +895,94 @@ void assembler(const string &inputFile, const string &outputFile) {
 
         //---------- .fill directive ----------
         else if (inst.opcode == ".fill") {
-            if (isNumber(inst.arg0))
-                machineCode = stoi(inst.arg0);
-            else if (symbolTable.count(inst.arg0))
+            if (isNumber(inst.arg0)) {
+                long long value = strtoll(inst.arg0.c_str(), nullptr, 10);
+                if (value < -2147483648LL || value > 2147483647LL)
+                    diag.error(inst, FIELD_ARG0, ".fill value " + inst.arg0 + " does not fit in 32 bits");
+                else
+                    machineCode = (int)value;
+            }
+            else if (symbolTable.count(inst.arg0)) {
                 machineCode = symbolTable[inst.arg0];
-            else {
-                cerr << "error: undefined label in .fill " << inst.arg0 << endl;
-                exit(1);
+                if (objectFile) relocations.push_back({i, "fill", inst.arg0});
+            }
+            else if (objectFile) {
+                imports.insert(inst.arg0);
+                relocations.push_back({i, "fill", inst.arg0});
             }
+            else if (!inst.arg0.empty())
+                diag.error(inst, FIELD_ARG0, "undefined label in .fill " + inst.arg0);
         }
 
-        //---------- ถ้าไม่รู้จัก opcode ----------
-        else {
-            cerr << "error: unrecognized opcode " << inst.opcode << endl;
-            exit(1);
-        }
+        // opcode ที่ไม่รู้จักแจ้ง error ไปแล้วใน checkOperands ของ PASS 1
 
-        // เขียน machine code ลงไฟล์ output (หนึ่งบรรทัดต่อคำสั่ง)
-        outFile << machineCode << endl;
+        image.push_back(machineCode);
     }
-
-    // ปิดไฟล์ทั้งหมด
     inFile.close();
+
+    // มี error → ไม่เขียนไฟล์ใด ๆ (ไฟล์ machine code เดิมยังอยู่ครบ)
+    if (diag.errors() > 0) {
+        diag.report();
+        exit(1);
+    }
+
+    if (objectFile) {
+        writeObjectFile(outputFile, image, symbolTable, exports, imports, relocations);
+        exit(0);
+    }
+
+    // เปิดไฟล์ผลลัพธ์สำหรับเขียน Machine Code (outputFile)
+    ofstream outFile(outputFile);
+        if (!outFile.is_open()) {               // ถ้าเปิดไฟล์ไม่ได้
+            cerr << "error opening " << outputFile << endl;
+            exit(1);
+        }
+
+    // เขียน machine code ลงไฟล์ output (หนึ่งบรรทัดต่อคำสั่ง)
+    for (int machineCode : image) outFile << machineCode << endl;
     outFile.close();
 
+    // เขียน symbol map ไว้ข้างไฟล์ machine code สำหรับ debugger ของ simulator
+    writeSymbolFile(symbolFileName(outputFile), symbolTable);
+
+    // เขียน source map ให้ simulator บอกบรรทัดใน assembly ของ pc ที่เกิด fault ได้โดยไม่ต้อง parse ใหม่
+    writeSourceMap(sourceMapFileName(outputFile), inputFile, instructions);
+
+    if (!headerFile.empty()) writeProgramHeader(headerFile, inputFile, image);
+
     // จบโปรแกรม
     exit(0);
 }
 
 
 // main function : เรียก assembler
-int main() {
+// ใช้งาน: assembler_2 [-O] [-H header.h | -c] [input.txt] [output.txt]
+// -O = เปิด peephole optimizer
+// -H = เขียน machine code เป็น constexpr header สำหรับ specialized_simulator.cpp ด้วย
+// -c = เขียน object file (output.obj) สำหรับ linker.cpp แทน machine code
+// ถ้าไม่ระบุไฟล์ จะใช้ไฟล์ค่าเริ่มต้นด้านล่าง
+int main(int argc, char *argv[]) {
     // เปลี่ยนชื่อไฟล์ตามที่ต้องการรัน
-    assembler("assembly/Multiplication.txt", "machine_code/machine_code.txt");
+    string inputFile = "assembly/Multiplication.txt";
+    string outputFile = "machine_code/machine_code.txt";
+    string headerFile;
+    bool optimizeCode = false, objectFile = false;
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-O") optimizeCode = true;
+        else if (arg == "-c") objectFile = true;
+        else if (arg == "-H" && i + 1 < argc) headerFile = argv[++i];
+        else files.push_back(arg);
+    }
+    if (objectFile && !headerFile.empty()) {
+        cerr << "error: -H needs a complete program, not an object file (-c)" << endl;
+        return 1;
+    }
+    if (files.size() > 0) inputFile = files[0];
+    if (files.size() > 1) outputFile = files[1];
+    else if (objectFile) outputFile = sideFileName(inputFile, ".obj");
+
+    assembler(inputFile, outputFile, optimizeCode, headerFile, objectFile);
     return 0;
 }
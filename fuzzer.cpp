@@ -0,0 +1,470 @@
+// Differential fuzzer: สุ่มโปรแกรม LC-2K แล้วรันบนทุก engine เทียบกับ reference
+// engine: step() / execute() / run() / runFast() ของ simulator_2 และ loop ของ not use/simulator.cpp
+// ทุก engine ต้องได้ผลลัพธ์ (สถานะ, pc, register, memory, จำนวนคำสั่ง) ตรงกันทุกประการ
+//
+// คอมไพล์: g++ -O2 -pthread fuzzer.cpp -o fuzzer
+// ใช้งาน:  fuzzer [-n cases] [-s seed] [-j threads] [-l steplimit] [-g rounds]
+//   -g = โหมด coverage-guided (เก็บโปรแกรมที่ทำให้เจอ edge ใหม่ไว้เป็น corpus แล้ว mutate ต่อ)
+// libFuzzer: clang++ -O2 -pthread -DLIBFUZZER -fsanitize=fuzzer fuzzer.cpp -o fuzzer
+#define SIMULATOR_NO_MAIN
+#include "simulator_2.cpp"
+
+#include <random>
+#include <functional>
+#include <cstring>
+#include <set>
+
+// ผลลัพธ์ของการรัน 1 ครั้ง (FUZZ_UNSUPPORTED = engine ไม่มีคำสั่งนี้ ไม่นำผลมาเทียบ)
+enum FuzzStatus { FUZZ_HALTED, FUZZ_STEP_LIMIT, FUZZ_FAULT, FUZZ_DEVICE, FUZZ_UNSUPPORTED };
+
+struct Outcome {
+    FuzzStatus status;
+    long long steps;
+    int pc;
+    vector<int> reg;
+    vector<int> mem;
+};
+
+// engine รับ image แล้วรันไม่เกิน maxSteps คำสั่ง
+// bounded = false คือ engine ที่ไม่มี step limit (เช่น runFast) จะรันเฉพาะ image ที่ reference หยุดเองภายใน maxSteps
+struct Engine {
+    string name;
+    function<Outcome(const vector<int> &, long long)> run;
+    bool bounded = true;
+};
+
+// ---------------------------------------------------------------------
+// Reference: เขียนตาม spec ของ LC-2K ตรง ๆ ไม่มีการ optimize ใด ๆ
+// edges (ถ้าไม่ใช่ nullptr) เก็บ coverage เป็นคู่ (pc, ผลของ beq) สำหรับโหมด guided
+// ---------------------------------------------------------------------
+
+Outcome referenceRun(const vector<int> &image, long long maxSteps, set<long long> *edges = nullptr) {
+    Outcome out{FUZZ_STEP_LIMIT, 0, 0, vector<int>(NUMREGS, 0), image};
+    out.mem.resize(NUMMEMORY, 0);
+    int &pc = out.pc;
+    vector<int> &reg = out.reg;
+    vector<int> &mem = out.mem;
+
+    while (out.steps < maxSteps) {
+        if (pc < 0 || pc >= NUMMEMORY) { out.status = FUZZ_FAULT; return out; }
+        out.steps++;
+
+        int instr = mem[pc];
+        int opcode = (instr >> 22) & 0x7;
+        int regA = (instr >> 19) & 0x7;
+        int regB = (instr >> 16) & 0x7;
+        int destReg = instr & 0x7;
+        int offset = convertNum(instr & 0xFFFF);
+        int addr = reg[regA] + offset;
+
+        if (opcode == 2 || opcode == 3 || (opcode == 7 && (instr & 0x3FFFFF))) {
+            if (addr < 0 || addr >= NUMMEMORY) { out.status = FUZZ_FAULT; return out; }
+            if (addr >= IO_BASE) { out.status = FUZZ_DEVICE; return out; }
+        }
+        if (edges) edges->insert(((long long)pc << 4) | (opcode << 1)
+                                 | (opcode == 4 && reg[regA] == reg[regB]));
+
+        if (opcode == 0) { reg[destReg] = reg[regA] + reg[regB]; pc++; }
+        else if (opcode == 1) { reg[destReg] = ~(reg[regA] & reg[regB]); pc++; }
+        else if (opcode == 2) { reg[regB] = mem[addr]; pc++; }
+        else if (opcode == 3) { mem[addr] = reg[regB]; pc++; }
+        else if (opcode == 4) { pc = (reg[regA] == reg[regB]) ? pc + 1 + offset : pc + 1; }
+        else if (opcode == 5) { reg[regB] = pc + 1; pc = reg[regA]; }
+        else if (opcode == 6) { out.status = FUZZ_HALTED; return out; }
+        else {
+            if (instr & 0x3FFFFF) { int old = mem[addr]; mem[addr] = reg[regB]; reg[regB] = old; }
+            pc++;
+        }
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------
+// Engine ของ simulator_2.cpp
+// ---------------------------------------------------------------------
+
+// หา address ที่คำสั่งถัดไปจะอ่าน/เขียน ถ้าอยู่ในช่วง device ให้หยุด (reference ไม่มี device)
+bool touchesDevice(const vector<int> &reg, int instr) {
+    int opcode = (instr >> 22) & 0x7;
+    if (opcode != 2 && opcode != 3 && !(opcode == 7 && (instr & 0x3FFFFF))) return false;
+    int addr = reg[(instr >> 19) & 0x7] + convertNum(instr & 0xFFFF);
+    return addr >= IO_BASE && addr < NUMMEMORY;
+}
+
+Outcome simulatorRun(const vector<int> &image, long long maxSteps) {
+    State state;
+    load(state, image);
+
+    Outcome out{FUZZ_STEP_LIMIT, 0, 0, {}, {}};
+    while (out.steps < maxSteps) {
+        if (state.pc >= 0 && state.pc < NUMMEMORY && touchesDevice(state.reg, state.mem[state.pc])) {
+            out.status = FUZZ_DEVICE;
+            break;
+        }
+        out.steps++;
+        StepResult result = step(state);
+        if (result == STEP_HALT) { out.status = FUZZ_HALTED; break; }
+        if (result == STEP_ERROR) { out.status = FUZZ_FAULT; break; }
+    }
+    // pc ออกนอกขอบเขตไม่นับเป็นคำสั่งที่รัน (ให้ตรงกับ reference)
+    if (out.status == FUZZ_FAULT && (state.pc < 0 || state.pc >= NUMMEMORY)) out.steps--;
+    out.pc = state.pc;
+    out.reg = state.reg;
+    out.mem = move(state.mem);
+    return out;
+}
+
+// execute() บน memory แบบ atomic (ทางที่ใช้ตอน multi-core แบบ parallel)
+Outcome atomicRun(const vector<int> &image, long long maxSteps) {
+    vector<atomic<int>> mem(NUMMEMORY);
+    for (size_t i = 0; i < image.size(); i++) mem[i].store(image[i], memory_order_relaxed);
+
+    Outcome out{FUZZ_STEP_LIMIT, 0, 0, vector<int>(NUMREGS, 0), {}};
+    while (out.steps < maxSteps) {
+        if (out.pc >= 0 && out.pc < NUMMEMORY && touchesDevice(out.reg, mem[out.pc])) {
+            out.status = FUZZ_DEVICE;
+            break;
+        }
+        out.steps++;
+        StepResult result = execute(out.pc, out.reg, mem, 0);
+        if (result == STEP_HALT) { out.status = FUZZ_HALTED; break; }
+        if (result == STEP_ERROR) { out.status = FUZZ_FAULT; break; }
+    }
+    if (out.status == FUZZ_FAULT && (out.pc < 0 || out.pc >= NUMMEMORY)) out.steps--;
+    out.mem.resize(NUMMEMORY);
+    for (int i = 0; i < NUMMEMORY; i++) out.mem[i] = mem[i].load(memory_order_relaxed);
+    return out;
+}
+
+// API run(max_steps) ของ simulator_2 แบ่งรันเป็นช่วงยาว 1, 3, 9, ... คำสั่ง พร้อม save/restore ระหว่างช่วง
+// (ถ้า reference ไปถึง device จะไม่นำผลมาเทียบ ทางนี้จึงไม่ต้องตรวจ device)
+Outcome resumableRun(const vector<int> &image, long long maxSteps) {
+    State state;
+    load(state, image);
+    long long instrCount = 0;
+    RunStatus status = RUN_STEP_LIMIT;
+    for (long long slice = 1; status == RUN_STEP_LIMIT && instrCount < maxSteps; slice *= 3) {
+        status = run(state, min(slice, maxSteps - instrCount), instrCount);
+        if (status == RUN_STEP_LIMIT) {
+            // checkpoint ลง buffer ในหน่วยความจำ แล้วเริ่มต่อจาก State ที่อ่านกลับมา
+            stringstream buffer;
+            saveState(state, instrCount, buffer);
+            state = State();
+            instrCount = 0;
+            restoreState(state, instrCount, buffer);
+        }
+    }
+
+    Outcome out{FUZZ_STEP_LIMIT, instrCount, state.pc, state.reg, move(state.mem)};
+    if (status == RUN_HALTED) out.status = FUZZ_HALTED;
+    if (status == RUN_FAULT) {
+        out.status = FUZZ_FAULT;
+        if (out.pc < 0 || out.pc >= NUMMEMORY) out.steps--;
+    }
+    return out;
+}
+
+// loop ของ simulator() เมื่อไม่กำหนด -n: runFast() ไม่มี step limit จึงรับ maxSteps ไว้เฉย ๆ
+Outcome fastRun(const vector<int> &image, long long) {
+    State state;
+    load(state, image);
+    long long instrCount = 0;
+    StepResult result = runFast(state, instrCount);
+
+    Outcome out{FUZZ_HALTED, instrCount, state.pc, state.reg, move(state.mem)};
+    if (result == STEP_ERROR) {
+        out.status = FUZZ_FAULT;
+        if (out.pc < 0 || out.pc >= NUMMEMORY) out.steps--;
+    }
+    return out;
+}
+
+// ---------------------------------------------------------------------
+// Engine ของ not use/simulator.cpp
+// simulator() ของไฟล์นั้นอ่าน machine code จากไฟล์ พิมพ์ state ทุกคำสั่ง และไม่มี step limit จึงเรียกตรง ๆ ไม่ได้
+// ที่นี่คัด switch ของมันมาทั้งชุด แล้วปรับเฉพาะส่วนที่เดิมเป็น undefined behavior ให้เทียบกับ reference ได้:
+//   memory ขยายเป็น NUMMEMORY word (เดิมมีแค่ขนาดไฟล์) และ fetch / lw / sw นอกขอบเขตเป็น fault
+//   halt เดิมเพิ่ม pc อีก 1 ก่อนหยุด จึงลบคืนตอนรายงาน pc
+//   opcode 7 เดิมเป็น noop อย่างเดียว (ยังไม่มี swap) ถ้าเจอ swap จะคืน FUZZ_UNSUPPORTED
+// ---------------------------------------------------------------------
+
+Outcome legacyRun(const vector<int> &image, long long maxSteps) {
+    Outcome out{FUZZ_STEP_LIMIT, 0, 0, vector<int>(NUMREGS, 0), image};
+    out.mem.resize(NUMMEMORY, 0);
+    int &pc = out.pc;
+    vector<int> &reg = out.reg;
+    vector<int> &mem = out.mem;
+
+    bool halted = false;
+    while (!halted && out.steps < maxSteps) {
+        if (pc < 0 || pc >= NUMMEMORY) { out.status = FUZZ_FAULT; return out; }
+
+        int instr = mem[pc];
+        int opcode = (instr >> 22) & 0x7;
+        int regA   = (instr >> 19) & 0x7;
+        int regB   = (instr >> 16) & 0x7;
+        int dest   = instr & 0x7;
+        int offset = convertNum(instr & 0xFFFF); // ใช้กับ I-type
+
+        if (opcode == 7 && (instr & 0x3FFFFF)) { out.status = FUZZ_UNSUPPORTED; return out; }
+        out.steps++;
+        if (opcode == 2 || opcode == 3) {
+            int addr = reg[regA] + offset;
+            if (addr < 0 || addr >= NUMMEMORY) { out.status = FUZZ_FAULT; return out; }
+            if (addr >= IO_BASE) { out.status = FUZZ_DEVICE; return out; }
+        }
+
+        switch (opcode) {
+            case 0: // add
+                reg[dest] = reg[regA] + reg[regB];
+                pc++;
+                break;
+
+            case 1: // nand
+                reg[dest] = ~(reg[regA] & reg[regB]);
+                pc++;
+                break;
+
+            case 2: // lw
+                reg[regB] = mem[reg[regA] + offset];
+                pc++;
+                break;
+
+            case 3: // sw
+                mem[reg[regA] + offset] = reg[regB];
+                pc++;
+                break;
+
+            case 4: // beq
+                if (reg[regA] == reg[regB])
+                    pc = pc + 1 + offset;
+                else
+                    pc++;
+                break;
+
+            case 5: // jalr
+                reg[regB] = pc + 1;
+                pc = reg[regA];
+                break;
+
+            case 6: // halt
+                halted = true;
+                pc++;
+                break;
+
+            case 7: // noop
+                pc++;
+                break;
+        }
+    }
+    if (halted) {
+        out.status = FUZZ_HALTED;
+        pc--;
+    }
+    return out;
+}
+
+// engine ใหม่ที่ต้องการทดสอบให้เพิ่มในรายการนี้
+vector<Engine> engines() {
+    return {
+        {"simulator_2", simulatorRun},
+        {"atomic", atomicRun},
+        {"run", resumableRun},
+        {"runFast", fastRun, false},
+        {"not use/simulator", legacyRun},
+    };
+}
+
+// ---------------------------------------------------------------------
+// การสุ่มโปรแกรมและการเปรียบเทียบ
+// ---------------------------------------------------------------------
+
+// สุ่ม image ที่ถูกต้อง: opcode/register สุ่ม, address ของ lw/sw ส่วนใหญ่อยู่ในช่วงโปรแกรม,
+// offset ของ beq อยู่ในช่วงโปรแกรม, ท้ายโปรแกรมเป็นข้อมูลสุ่ม
+vector<int> randomImage(mt19937 &rng) {
+    int codeSize = uniform_int_distribution<int>(2, 48)(rng);
+    int dataSize = uniform_int_distribution<int>(0, 16)(rng);
+    int total = codeSize + dataSize;
+    auto pick = [&](int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(rng); };
+
+    vector<int> image;
+    for (int i = 0; i < codeSize; i++) {
+        int opcode = pick(0, 7);
+        if (opcode == 6 && pick(0, 3) != 0) opcode = pick(0, 5);    // halt ไม่บ่อยเกินไป
+        int regA = pick(0, 7), regB = pick(0, 7);
+        int offset = 0;
+        if (opcode == 2 || opcode == 3 || opcode == 7) {
+            if (pick(0, 3) != 0) regA = 0;                           // ส่วนใหญ่ใช้ address ตรง
+            offset = pick(0, total + 8);
+            if (opcode == 7 && pick(0, 1)) { regA = regB = offset = 0; }   // noop
+        } else if (opcode == 4) {
+            offset = pick(-i - 1, total - i - 1);
+        } else if (opcode == 0 || opcode == 1) {
+            offset = pick(0, 7);
+        }
+        image.push_back((opcode << 22) | (regA << 19) | (regB << 16) | (offset & 0xFFFF));
+    }
+    for (int i = 0; i < dataSize; i++)
+        image.push_back(pick(0, 3) ? pick(-16, 64) : (int)rng());
+    return image;
+}
+
+bool sameOutcome(const Outcome &a, const Outcome &b) {
+    return a.status == b.status && a.steps == b.steps && a.pc == b.pc
+        && a.reg == b.reg && a.mem == b.mem;
+}
+
+const char *statusName(FuzzStatus status) {
+    switch (status) {
+        case FUZZ_HALTED: return "halted";
+        case FUZZ_STEP_LIMIT: return "step limit";
+        case FUZZ_FAULT: return "fault";
+        case FUZZ_UNSUPPORTED: return "unsupported";
+        default: return "device";
+    }
+}
+
+// หาคำสั่งแรกที่ผลต่างกัน ด้วย binary search บนจำนวนคำสั่ง (engine ทุกตัว deterministic)
+long long firstDivergence(const Engine &engine, const vector<int> &image, long long maxSteps) {
+    long long lo = 0, hi = maxSteps;    // รัน lo คำสั่งแล้วยังตรงกัน, รัน hi คำสั่งแล้วไม่ตรง
+    while (hi - lo > 1) {
+        long long mid = lo + (hi - lo) / 2;
+        if (sameOutcome(referenceRun(image, mid), engine.run(image, mid))) lo = mid;
+        else hi = mid;
+    }
+    return hi;
+}
+
+// เขียน image ที่ทำให้ผลต่างกันลงไฟล์ machine code เพื่อเปิดด้วย simulator_2 -d ต่อได้
+void reportDivergence(const Engine &engine, const vector<int> &image, long long maxSteps,
+                      const Outcome &expected, const Outcome &actual, const string &tag) {
+    string file = "fuzz_fail_" + tag + ".txt";
+    ofstream outFile(file);
+    for (int word : image) outFile << word << endl;
+
+    cout << "DIVERGENCE in " << engine.name << " (" << tag << ")\n";
+    cout << "  reference: " << statusName(expected.status) << " after " << expected.steps
+         << " steps, pc " << expected.pc << "\n";
+    cout << "  " << engine.name << ": " << statusName(actual.status) << " after " << actual.steps
+         << " steps, pc " << actual.pc << "\n";
+    // engine ที่ไม่มี step limit หยุดกลางทางไม่ได้ จึงหาคำสั่งแรกที่ต่างด้วย binary search ไม่ได้
+    if (engine.bounded) {
+        long long stepNo = firstDivergence(engine, image, maxSteps);
+        Outcome before = referenceRun(image, stepNo - 1);
+        cout << "  first diverging step " << stepNo << " at pc " << before.pc;
+        if (before.pc >= 0 && before.pc < NUMMEMORY) cout << " (word " << before.mem[before.pc] << ")";
+        cout << "\n";
+    }
+    cout << "  image written to " << file << "\n";
+}
+
+// รัน image บนทุก engine แล้วเทียบกับ reference; คืนค่า false ถ้าเจอผลต่าง
+bool checkImage(const vector<int> &image, long long maxSteps, const string &tag,
+                mutex &printLock, set<long long> *edges = nullptr) {
+    Outcome expected = referenceRun(image, maxSteps, edges);
+    if (expected.status == FUZZ_DEVICE) return true;    // reference ไม่มี device เทียบไม่ได้
+    for (const Engine &engine : engines()) {
+        if (!engine.bounded && expected.status == FUZZ_STEP_LIMIT) continue;
+        Outcome actual = engine.run(image, maxSteps);
+        if (actual.status == FUZZ_UNSUPPORTED) continue;
+        if (!sameOutcome(expected, actual)) {
+            lock_guard<mutex> guard(printLock);
+            reportDivergence(engine, image, maxSteps, expected, actual, tag);
+            return false;
+        }
+    }
+    return true;
+}
+
+// mutate image เดิม: เปลี่ยน field ของคำสั่ง, สลับ/คัดลอกคำสั่ง หรือสุ่ม word ใหม่
+vector<int> mutate(vector<int> image, mt19937 &rng) {
+    auto pick = [&](int lo, int hi) { return uniform_int_distribution<int>(lo, hi)(rng); };
+    int n = (int)image.size();
+    int count = pick(1, 3);
+    for (int k = 0; k < count; k++) {
+        int i = pick(0, n - 1);
+        switch (pick(0, 4)) {
+            case 0: image[i] ^= 1 << pick(0, 24); break;                   // flip 1 bit
+            case 1: image[i] = (image[i] & ~(0x7 << 22)) | (pick(0, 7) << 22); break;
+            case 2: image[i] = (image[i] & ~0xFFFF) | (pick(-n, n) & 0xFFFF); break;
+            case 3: swap(image[i], image[pick(0, n - 1)]); break;
+            default: image[i] = image[pick(0, n - 1)]; break;
+        }
+    }
+    return image;
+}
+
+// ---------------------------------------------------------------------
+
+#ifdef LIBFUZZER
+// libFuzzer: แปลง byte เป็น word ละ 4 byte (ตัดให้เหลือ 25 บิตเพื่อให้เป็นคำสั่งที่ถูกต้อง)
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    static bool quiet = (cerr.rdbuf(nullptr), true);
+    (void)quiet;
+    if (size < 4) return 0;
+    vector<int> image(min(size / 4, (size_t)256));
+    for (size_t i = 0; i < image.size(); i++) {
+        uint32_t word;
+        memcpy(&word, data + 4 * i, 4);
+        image[i] = (int)(word & 0x1FFFFFF);
+    }
+    static mutex printLock;
+    if (!checkImage(image, 10000, "libfuzzer", printLock)) abort();
+    return 0;
+}
+#else
+int main(int argc, char *argv[]) {
+    long long cases = 100000, maxSteps = 10000, guidedRounds = 0;
+    unsigned seed = 1;
+    int threads = max(1u, thread::hardware_concurrency());
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        if (arg == "-n") cases = atoll(argv[i + 1]);
+        else if (arg == "-s") seed = (unsigned)atoll(argv[i + 1]);
+        else if (arg == "-j") threads = max(1, atoi(argv[i + 1]));
+        else if (arg == "-l") maxSteps = atoll(argv[i + 1]);
+        else if (arg == "-g") guidedRounds = atoll(argv[i + 1]);
+    }
+
+    cerr.rdbuf(nullptr);    // ปิดข้อความ error ของ simulator (fault เป็นเรื่องปกติของโปรแกรมสุ่ม)
+    mutex printLock;
+    atomic<long long> failures(0);
+    auto start = chrono::steady_clock::now();
+
+    if (guidedRounds > 0) {
+        // coverage-guided: thread เดียว เก็บ corpus ของ image ที่เพิ่ม edge ใหม่
+        mt19937 rng(seed);
+        set<long long> covered;
+        vector<vector<int>> corpus;
+        for (long long n = 0; n < guidedRounds; n++) {
+            vector<int> image = (corpus.empty() || rng() % 8 == 0)
+                              ? randomImage(rng) : mutate(corpus[rng() % corpus.size()], rng);
+            set<long long> edges;
+            if (!checkImage(image, maxSteps, "guided_" + to_string(n), printLock, &edges)) failures++;
+            size_t before = covered.size();
+            covered.insert(edges.begin(), edges.end());
+            if (covered.size() > before) corpus.push_back(image);
+        }
+        cout << "corpus " << corpus.size() << " images, " << covered.size() << " edges covered\n";
+        cases = guidedRounds;
+    } else {
+        // สุ่มแบบอิสระ แบ่ง case ให้แต่ละ thread (seed ของแต่ละ case คงที่ จึงทำซ้ำได้)
+        vector<thread> workers;
+        for (int t = 0; t < threads; t++) {
+            workers.emplace_back([&, t]() {
+                for (long long n = t; n < cases; n += threads) {
+                    mt19937 rng(seed + (unsigned)n * 2654435761u);
+                    vector<int> image = randomImage(rng);
+                    if (!checkImage(image, maxSteps, to_string(seed) + "_" + to_string(n), printLock))
+                        failures++;
+                }
+            });
+        }
+        for (thread &worker : workers) worker.join();
+    }
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << cases << " cases, " << failures << " divergences, " << elapsed << " s\n";
+    return failures > 0 ? 1 : 0;
+}
+#endif
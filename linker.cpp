@@ -0,0 +1,227 @@
+// Linker: รวม object file ที่ assembler_2 -c เขียนไว้ ให้เป็นโปรแกรมเดียวที่ simulator รันได้
+// library ที่ใช้บ่อย (เช่น combi) จึง assemble ครั้งเดียวแล้ว link เข้ากับหลายโปรแกรมได้
+//
+// คอมไพล์: g++ -O2 linker.cpp -o linker
+// ใช้งาน:  linker [-o machine_code.txt] main.obj lib.obj ...
+//   module เรียงใน memory ตามลำดับบน command line โปรแกรมเริ่มที่ pc 0 จึงต้องให้ main อยู่ก่อน
+//   เช่น  ./assembler_2 -c assembly/CombiMain.txt machine_code/CombiMain.obj
+//         ./assembler_2 -c assembly/CombiLib.txt machine_code/CombiLib.obj
+//         ./assembler_2 -c assembly/Stack.txt machine_code/Stack.obj
+//         ./linker -o machine_code/machine_code.txt machine_code/CombiMain.obj machine_code/CombiLib.obj machine_code/Stack.obj
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <cstdio>
+using namespace std;
+
+// relocation: word ที่ address (ภายใน module) ต้องแทนด้วย address ของ symbol
+struct Relocation {
+    int address;
+    bool offsetField;       // true = 16 บิตล่างของ lw/sw/swap, false = ทั้ง word ของ .fill
+    string symbol;
+};
+
+struct ObjectModule {
+    string file;
+    int base = 0;                           // address เริ่มต้นของ module ในโปรแกรมที่ link แล้ว
+    vector<int> words;
+    unordered_map<string, int> locals;      // label ทุกตัวที่ประกาศใน module (รวมตัวที่ export)
+    vector<string> exports;
+    vector<string> imports;
+    vector<Relocation> relocations;
+};
+
+// symbol ที่ export: address ในโปรแกรมที่ link แล้ว และ module ที่ประกาศ
+struct GlobalSymbol {
+    int address;
+    int module;
+};
+
+// อ่าน object file ตามรูปแบบที่ writeObjectFile ของ assembler_2 เขียนไว้
+bool readObject(const string &filename, ObjectModule &module) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "error: can't open file " << filename << endl;
+        return false;
+    }
+
+    string magic;
+    int numWords, numSymbols, numRelocations;
+    if (!(file >> magic >> numWords >> numSymbols >> numRelocations) || magic != "LC2KOBJ") {
+        cerr << "error: " << filename << " is not an object file (assemble with assembler_2 -c)" << endl;
+        return false;
+    }
+
+    module.file = filename;
+    module.words.resize(numWords);
+    for (int &word : module.words) file >> word;
+    for (int i = 0; i < numSymbols; i++) {
+        string name, type;
+        int addr;
+        file >> name >> type >> addr;
+        if (type == "U") module.imports.push_back(name);
+        else {
+            module.locals[name] = addr;
+            if (type == "D") module.exports.push_back(name);
+        }
+    }
+    for (int i = 0; i < numRelocations; i++) {
+        Relocation reloc;
+        string kind;
+        file >> reloc.address >> kind >> reloc.symbol;
+        reloc.offsetField = (kind == "offset");
+        if (reloc.address < 0 || reloc.address >= numWords) {
+            cerr << "error: relocation outside module in " << filename << endl;
+            return false;
+        }
+        module.relocations.push_back(reloc);
+    }
+    if (!file) {
+        cerr << "error: " << filename << " is truncated" << endl;
+        return false;
+    }
+    return true;
+}
+
+// ชื่อ module สำหรับ label ภายในที่ชื่อซ้ำกันหลาย module เช่น "machine_code/CombiLib.obj" → "CombiLib"
+string moduleName(const string &file) {
+    size_t slash = file.find_last_of('/');
+    string name = (slash == string::npos) ? file : file.substr(slash + 1);
+    return name.substr(0, name.find('.'));
+}
+
+// ชื่อไฟล์ข้างไฟล์ machine code (แบบเดียวกับ assembler_2 / simulator_2)
+string sideFileName(const string &machineFile, const string &extension) {
+    size_t dot = machineFile.find_last_of('.');
+    size_t slash = machineFile.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return machineFile + extension;
+    return machineFile.substr(0, dot) + extension;
+}
+
+// เขียน symbol map (.sym) ให้ debugger / sweep ของโปรแกรมที่ link แล้ว
+// label ภายในที่ชื่อซ้ำกันหลาย module จะเขียนเป็น module.label
+void writeSymbolFile(const string &fileName, const vector<ObjectModule> &modules) {
+    ofstream symFile(fileName);
+    if (!symFile.is_open()) {
+        cerr << "error opening " << fileName << endl;
+        exit(1);
+    }
+
+    unordered_map<string, int> uses;
+    for (const ObjectModule &module : modules)
+        for (const auto &entry : module.locals) uses[entry.first]++;
+
+    map<int, vector<string>> byAddress;
+    for (const ObjectModule &module : modules)
+        for (const auto &entry : module.locals) {
+            string name = (uses[entry.first] > 1) ? moduleName(module.file) + "." + entry.first : entry.first;
+            byAddress[module.base + entry.second].push_back(name);
+        }
+    for (const auto &entry : byAddress)
+        for (const string &name : entry.second)
+            symFile << name << " " << entry.first << endl;
+}
+
+int main(int argc, char *argv[]) {
+    string outputFile = "machine_code/machine_code.txt";
+    vector<string> inputs;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) outputFile = argv[++i];
+        else inputs.push_back(arg);
+    }
+    if (inputs.empty()) {
+        cerr << "usage: linker [-o machine_code.txt] main.obj [lib.obj ...]" << endl;
+        return 1;
+    }
+
+    // อ่านทุก module และวางต่อกันตามลำดับ
+    vector<ObjectModule> modules(inputs.size());
+    int size = 0;
+    for (size_t m = 0; m < inputs.size(); m++) {
+        if (!readObject(inputs[m], modules[m])) return 1;
+        modules[m].base = size;
+        size += (int)modules[m].words.size();
+    }
+
+    // hash table ของ symbol ที่ export จากทุก module
+    int errors = 0;
+    unordered_map<string, GlobalSymbol> globals;
+    for (int m = 0; m < (int)modules.size(); m++) {
+        for (const string &name : modules[m].exports) {
+            auto found = globals.find(name);
+            if (found != globals.end()) {
+                cerr << "error: duplicate symbol " << name << " in " << modules[m].file
+                     << " (first defined in " << modules[found->second.module].file << ")" << endl;
+                errors++;
+                continue;
+            }
+            globals[name] = {modules[m].base + modules[m].locals[name], m};
+        }
+    }
+
+    // import ที่ไม่มี module ไหน export
+    for (const ObjectModule &module : modules)
+        for (const string &name : module.imports)
+            if (!globals.count(name)) {
+                cerr << "error: undefined symbol " << name << " imported by " << module.file << endl;
+                errors++;
+            }
+
+    // รวม machine code แล้วแก้ทุก relocation ใน loop เดียว
+    // symbol หาใน label ของ module เองก่อน ถ้าไม่มีจึงหาใน symbol ที่ export
+    vector<int> image;
+    image.reserve(size);
+    for (const ObjectModule &module : modules)
+        image.insert(image.end(), module.words.begin(), module.words.end());
+
+    for (const ObjectModule &module : modules) {
+        for (const Relocation &reloc : module.relocations) {
+            int value;
+            auto local = module.locals.find(reloc.symbol);
+            if (local != module.locals.end()) {
+                value = module.base + local->second;
+            } else {
+                auto global = globals.find(reloc.symbol);
+                if (global == globals.end()) continue;     // แจ้ง error ไปแล้วตอนตรวจ import
+                value = global->second.address;
+            }
+
+            int &word = image[module.base + reloc.address];
+            if (!reloc.offsetField) {
+                word = value;
+            } else if (value > 32767) {
+                cerr << "error: address of " << reloc.symbol << " (" << value << ") does not fit in "
+                     << "offsetField, referenced from " << module.file << endl;
+                errors++;
+            } else {
+                word = (word & ~0xFFFF) | value;
+            }
+        }
+    }
+
+    if (errors > 0) {
+        cerr << errors << (errors == 1 ? " error" : " errors") << " generated" << endl;
+        return 1;
+    }
+
+    ofstream outFile(outputFile);
+    if (!outFile.is_open()) {
+        cerr << "error opening " << outputFile << endl;
+        return 1;
+    }
+    for (int word : image) outFile << word << endl;
+    outFile.close();
+
+    writeSymbolFile(sideFileName(outputFile, ".sym"), modules);
+    // source map ของ assembler อ้างไฟล์ assembly เดียว ใช้กับโปรแกรมที่ link แล้วไม่ได้ จึงลบไฟล์เก่าทิ้ง
+    remove(sideFileName(outputFile, ".map").c_str());
+
+    cout << "linked " << modules.size() << " modules, " << image.size() << " words, "
+         << globals.size() << " global symbols" << endl;
+    return 0;
+}
@@ -0,0 +1,29 @@
+// generated by assembler_2 -H from assembly/Multiplication.txt -- do not edit
+#pragma once
+#include <array>
+
+constexpr std::array<int, 23> PROGRAM = {
+    8519698,
+    8585235,
+    1,
+    8650772,
+    8716310,
+    29360128,
+    6029318,
+    7733254,
+    19922945,
+    655361,
+    29360128,
+    1179650,
+    2359300,
+    8847381,
+    3080197,
+    19398657,
+    16842740,
+    25165824,
+    32766,
+    10383,
+    1,
+    -1,
+    16
+};
@@ -1,24 +1,47 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
+#include <map>
+#include <cstdint>
 #include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <cctype>
+#include <climits>
+#include <memory>
 using namespace std;
 
 const int NUMMEMORY = 65536;
 const int NUMREGS = 8;
 
+// memory map: address ตั้งแต่ IO_BASE ขึ้นไปสงวนไว้สำหรับ device / register พิเศษ
+const int IO_BASE = 65532;
+const int IN_DATA_ADDR = 65532;     // lw ได้ word ถัดไปจาก input device (หมดแล้วได้ 0)
+const int IN_STATUS_ADDR = 65533;   // lw ได้ 1 ถ้า input ยังเหลือ, 0 ถ้าหมดแล้ว
+const int OUT_DATA_ADDR = 65534;    // sw เขียน word ต่อท้าย output device
+const int CORE_ID_ADDR = 65535;     // lw จาก address นี้ได้หมายเลข core ที่กำลังรัน
+
 struct State {
     int pc;
     vector<int> mem;
     vector<int> reg;
+    int numMemory;      // จำนวน word ที่โหลดจากไฟล์ (ใช้ตอน printState)
 };
 
+// ผลของการรันคำสั่ง 1 คำสั่ง
+enum StepResult { STEP_OK, STEP_HALT, STEP_ERROR };
+
 void printState(const State &state) {
     cout << "\n@@@\nstate:\n";
     cout << "\tpc " << state.pc << "\n";
     cout << "\tmemory:\n";
-    for (size_t i = 0; i < state.mem.size(); i++)
+    for (int i = 0; i < state.numMemory; i++)
         cout << "\t\tmem[ " << i << " ] " << state.mem[i] << "\n";
     cout << "\tregisters:\n";
     for (int i = 0; i < NUMREGS; i++)
@@ -32,89 +55,1092 @@ int convertNum(int num) {
     return num;
 }
 
-int simulator(const string &filename) {
+// ชื่อไฟล์ที่ assembler เขียนไว้ข้างไฟล์ machine code (เปลี่ยนนามสกุล)
+// เช่น "machine_code/machine_code.txt" → "machine_code/machine_code.sym"
+string sideFileName(const string &machineFile, const string &extension) {
+    size_t dot = machineFile.find_last_of('.');
+    size_t slash = machineFile.find_last_of('/');
+    if (dot == string::npos || (slash != string::npos && dot < slash))
+        return machineFile + extension;
+    return machineFile.substr(0, dot) + extension;
+}
+
+string symbolFileName(const string &machineFile) {
+    return sideFileName(machineFile, ".sym");
+}
+
+string sourceMapFileName(const string &machineFile) {
+    return sideFileName(machineFile, ".map");
+}
+
+// source map (.map) ที่ assembler เขียนไว้: ช่วงของ address → บรรทัดในไฟล์ assembly
+// แต่ละช่วงเริ่มที่ address และบรรทัดเพิ่มทีละ step (0 หรือ 1) ต่อ word จนถึงช่วงถัดไป
+struct SourceMap {
+    struct Run {
+        int address, line, step;
+    };
+    string source;
+    int words = 0;
+    vector<Run> runs;
+};
+
+bool loadSourceMap(const string &filename, SourceMap &sourceMap) {
     ifstream file(filename);
-    if (!file.is_open()) {
-        cerr << "error: can't open file " << filename << endl;
-        return 1;
-    }
+    string keyword;
+    if (!(file >> keyword >> sourceMap.source >> sourceMap.words) || keyword != "source") return false;
+    SourceMap::Run run;
+    while (file >> run.address >> run.line >> run.step) sourceMap.runs.push_back(run);
+    return true;
+}
 
-    State state;
+// บรรทัดใน assembly ของ address นี้ (0 = ไม่อยู่ในโปรแกรม)
+int sourceLine(const SourceMap &sourceMap, int addr) {
+    if (addr < 0 || addr >= sourceMap.words) return 0;
+    auto it = upper_bound(sourceMap.runs.begin(), sourceMap.runs.end(), addr,
+                          [](int a, const SourceMap::Run &run) { return a < run.address; });
+    if (it == sourceMap.runs.begin()) return 0;
+    --it;
+    return it->line + (addr - it->address) * it->step;
+}
+
+// บอกตำแหน่งใน assembly ของคำสั่งที่เกิด fault (อ่าน .map เฉพาะตอนเกิด fault เท่านั้น)
+void printFaultLocation(const string &machineFile, int pc) {
+    cerr << "  at pc " << pc;
+    SourceMap sourceMap;
+    int line = loadSourceMap(sourceMapFileName(machineFile), sourceMap) ? sourceLine(sourceMap, pc) : 0;
+    if (line > 0) cerr << " (" << sourceMap.source << ":" << line << ")";
+    cerr << endl;
+}
+
+// ---------------------------------------------------------------------
+// API สำหรับใช้เป็น library: load → run(max_steps) → save/restore → run ต่อ
+// ---------------------------------------------------------------------
+
+// ผลของ run(): หยุดเพราะ halt, ครบจำนวนคำสั่งที่กำหนด หรือเกิด fault
+enum RunStatus { RUN_HALTED, RUN_STEP_LIMIT, RUN_FAULT };
+
+// เริ่มเครื่องใหม่จาก image (pc = 0, register เป็นศูนย์)
+void load(State &state, const vector<int> &image) {
     state.pc = 0;
     state.reg = vector<int>(NUMREGS, 0);
-    state.mem.clear();
+    state.mem = image;
+    state.numMemory = (int)image.size();
+    state.mem.resize(NUMMEMORY, 0);
+}
+
+// โหลด machine code จากไฟล์ลง memory (ขนาดเต็ม NUMMEMORY เพื่อให้ stack โตเกินโปรแกรมได้)
+bool loadProgram(const string &filename, State &state) {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "error: can't open file " << filename << endl;
+        return false;
+    }
 
+    vector<int> image;
     string line;
     while (getline(file, line)) {
         if (line.empty()) continue;
-        state.mem.push_back(stoi(line));
-        // cout << "memory[" << state.mem.size() - 1 << "]=" << state.mem.back() << endl;
+        image.push_back(stoi(line));
+        // cout << "memory[" << image.size() - 1 << "]=" << image.back() << endl;
+    }
+
+    load(state, image);
+    return true;
+}
+
+// swap แบบ atomic: เขียนค่าใหม่ลง memory แล้วคืนค่าเดิม
+// memory ธรรมดาใช้ตอนรันแบบ core เดียวหรือ round-robin ส่วน atomic ใช้ตอนรันหลาย thread
+inline int exchangeWord(int &word, int value) {
+    int old = word;
+    word = value;
+    return old;
+}
+
+inline int exchangeWord(atomic<int> &word, int value) {
+    return word.exchange(value);
+}
+
+// input device: อ่านตัวเลขฐานสิบจากไฟล์หรือ pipe ทีละก้อนใหญ่ (ไม่อ่านทีละบรรทัด)
+struct InputDevice {
+    FILE *file = nullptr;
+    vector<char> buf = vector<char>(1 << 16);
+    size_t pos = 0, len = 0;
+
+    bool refill() {
+        if (!file) return false;
+        len = fread(buf.data(), 1, buf.size(), file);
+        pos = 0;
+        return len > 0;
+    }
+
+    // ข้ามช่องว่าง แล้วบอกว่ายังมีตัวเลขเหลือหรือไม่
+    bool hasNext() {
+        while (true) {
+            while (pos < len && isspace((unsigned char)buf[pos])) pos++;
+            if (pos < len) return true;
+            if (!refill()) return false;
+        }
+    }
+
+    // อ่านตัวเลขถัดไป (หมดแล้วได้ 0) คืนค่า false ถ้า token ไม่ใช่ตัวเลข 32 บิต
+    // token ที่ผิดถูกอ่านทิ้งไปทั้งตัวเสมอ จึงไม่วนอ่านตัวเดิมซ้ำ
+    bool next(int &value) {
+        value = 0;
+        if (!hasNext()) return true;
+        string token;
+        while (true) {
+            if (pos == len && !refill()) break;
+            if (isspace((unsigned char)buf[pos])) break;
+            if (token.size() < 16) token += buf[pos];   // ยาวกว่านี้เกิน 32 บิตแน่นอน
+            pos++;
+        }
+
+        size_t i = (token[0] == '-') ? 1 : 0;
+        long long number = 0;
+        bool ok = (i < token.size() && token.size() < 16);
+        for (; ok && i < token.size(); i++) {
+            if (token[i] < '0' || token[i] > '9') ok = false;
+            else number = number * 10 + (token[i] - '0');
+        }
+        if (token[0] == '-') number = -number;
+        if (!ok || number < INT_MIN || number > INT_MAX) {
+            cerr << "error: bad input value " << token << endl;
+            return false;
+        }
+        value = (int)number;
+        return true;
+    }
+};
+
+// output device: เก็บผลลัพธ์ไว้ใน buffer แล้วเขียนออกไฟล์ทีละก้อน
+struct OutputDevice {
+    FILE *file = stdout;
+    vector<char> buf = vector<char>(1 << 16);
+    size_t len = 0;
+
+    void put(int value) {
+        if (len + 16 > buf.size()) flush();
+        len += snprintf(buf.data() + len, 16, "%d\n", value);
+    }
+
+    void flush() {
+        if (len > 0) fwrite(buf.data(), 1, len, file);
+        len = 0;
+        fflush(file);
+    }
+};
+
+InputDevice inputDevice;
+OutputDevice outputDevice;
+mutex deviceLock;       // ป้องกัน device ตอนรันหลาย thread (อยู่นอก fast path)
+
+// ถ้าตั้งไว้ sw ไปที่ OUT_DATA_ADDR ของ thread นี้จะต่อท้าย vector นี้แทน output device
+// (sweep ใช้เก็บ output ของแต่ละ job แยกกัน ไม่ให้ปนกันใน stdout)
+thread_local vector<int> *capturedOutput = nullptr;
+
+// เปิดไฟล์ให้ device ("-" = stdin/stdout)
+bool openDevices(const string &inputFile, const string &outputFile) {
+    if (!inputFile.empty()) {
+        inputDevice.file = (inputFile == "-") ? stdin : fopen(inputFile.c_str(), "r");
+        if (!inputDevice.file) {
+            cerr << "error: can't open input device " << inputFile << endl;
+            return false;
+        }
+    }
+    if (!outputFile.empty() && outputFile != "-") {
+        outputDevice.file = fopen(outputFile.c_str(), "w");
+        if (!outputDevice.file) {
+            cerr << "error: can't open output device " << outputFile << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// อ่าน/เขียน address ที่อยู่ในช่วง device (IO_BASE ขึ้นไป) หรือนอกขอบเขต memory
+// แยกออกมาจาก execute() เพื่อให้ lw/sw ปกติเสียแค่การเปรียบเทียบครั้งเดียว
+bool deviceLoad(int addr, int coreId, int &value) {
+    switch (addr) {
+        case CORE_ID_ADDR:
+            value = coreId;
+            return true;
+        case IN_DATA_ADDR: {
+            lock_guard<mutex> guard(deviceLock);
+            return inputDevice.next(value);
+        }
+        case IN_STATUS_ADDR: {
+            lock_guard<mutex> guard(deviceLock);
+            value = inputDevice.hasNext() ? 1 : 0;
+            return true;
+        }
+        case OUT_DATA_ADDR:
+            value = 0;
+            return true;
+    }
+    cerr << "error: memory address out of bounds" << endl;
+    return false;
+}
+
+bool deviceStore(int addr, int value) {
+    switch (addr) {
+        case OUT_DATA_ADDR: {
+            if (capturedOutput) {
+                capturedOutput->push_back(value);
+                return true;
+            }
+            lock_guard<mutex> guard(deviceLock);
+            outputDevice.put(value);
+            return true;
+        }
+        case IN_DATA_ADDR:
+        case IN_STATUS_ADDR:
+        case CORE_ID_ADDR:
+            return true;    // register อ่านได้อย่างเดียว เขียนแล้วไม่มีผล
     }
+    cerr << "error: memory address out of bounds" << endl;
+    return false;
+}
 
-    int instrCount = 0;
+// รันคำสั่งที่ pc ปัจจุบัน 1 คำสั่งของ core หนึ่ง
+// Memory เป็นได้ทั้ง vector<int> และ vector<atomic<int>> (memory ที่แชร์ระหว่าง thread)
+// คำสั่งเพิ่มเติม: opcode 7 ที่ field ไม่เป็นศูนย์ทั้งหมดคือ swap regA regB offset
+//   สลับค่า reg[regB] กับ mem[reg[regA] + offset] แบบ atomic (noop ปกติเข้ารหัสเป็นศูนย์ทุก field)
+template <typename Memory>
+inline StepResult execute(int &pc, vector<int> &reg, Memory &mem, int coreId) {
+    if (pc < 0 || pc >= NUMMEMORY) {
+        cerr << "error: pc out of bounds" << endl;
+        return STEP_ERROR;
+    }
+
+    int instr = mem[pc];
+    int opcode = (instr >> 22) & 0x7;
+    int regA = (instr >> 19) & 0x7;
+    int regB = (instr >> 16) & 0x7;
+    int offset = convertNum(instr & 0xFFFF);
+
+    switch (opcode) {
+        case 0: // add
+            reg[instr & 0x7] = reg[regA] + reg[regB];
+            pc++;
+            break;
+        case 1: // nand
+            reg[instr & 0x7] = ~(reg[regA] & reg[regB]);
+            pc++;
+            break;
+        case 2: { // lw
+            int addr = reg[regA] + offset;
+            if ((unsigned)addr >= (unsigned)IO_BASE) {
+                if (!deviceLoad(addr, coreId, reg[regB])) return STEP_ERROR;
+            } else {
+                reg[regB] = mem[addr];
+            }
+            pc++;
+            break;
+        }
+        case 3: { // sw
+            int addr = reg[regA] + offset;
+            if ((unsigned)addr >= (unsigned)IO_BASE) {
+                if (!deviceStore(addr, reg[regB])) return STEP_ERROR;
+            } else {
+                mem[addr] = reg[regB];
+            }
+            pc++;
+            break;
+        }
+        case 4: // beq
+            if (reg[regA] == reg[regB])
+                pc = pc + 1 + offset;
+            else
+                pc++;
+            break;
+        case 5: // jalr (เก็บ pc+1 ลง regB ก่อน แล้วจึงกระโดดไปที่ reg[regA] ตาม spec)
+            reg[regB] = pc + 1;
+            pc = reg[regA];
+            break;
+        case 6: // halt
+            return STEP_HALT;
+        case 7: // noop / swap
+            if (instr & 0x3FFFFF) {
+                int addr = reg[regA] + offset;
+                if ((unsigned)addr >= (unsigned)IO_BASE) {
+                    cerr << "error: swap on device address" << endl;
+                    return STEP_ERROR;
+                }
+                reg[regB] = exchangeWord(mem[addr], reg[regB]);
+            }
+            pc++;
+            break;
+        default:
+            cerr << "error: invalid opcode " << opcode << endl;
+            return STEP_ERROR;
+    }
+    return STEP_OK;
+}
+
+// ทั้ง loop ปกติและ loop ของ debugger เรียกฟังก์ชันนี้ จึงมีพฤติกรรมเหมือนกันทุกประการ
+inline StepResult step(State &state) {
+    return execute(state.pc, state.reg, state.mem, 0);
+}
 
-    while (true) {
+// loop ปกติ: ไม่มีการตรวจ breakpoint ใด ๆ
+StepResult runFast(State &state, long long &instrCount) {
+    StepResult result;
+    do {
         // printState(state);
+        instrCount++;
+        result = step(state);
+    } while (result == STEP_OK);
+    return result;
+}
+
+// รันไม่เกิน maxSteps คำสั่ง แล้วคืนสถานะ; ถ้าได้ RUN_STEP_LIMIT เรียก run ซ้ำเพื่อรันต่อได้
+// การตรวจต่อคำสั่งมีแค่การลดตัวนับ 1 ครั้ง (นับจำนวนคำสั่งจริงรวมทีเดียวตอนจบ)
+RunStatus run(State &state, long long maxSteps, long long &instrCount) {
+    long long left = maxSteps;
+    StepResult result = STEP_OK;
+    while (left > 0) {
+        left--;
+        result = step(state);
+        if (result != STEP_OK) break;
+    }
+    instrCount += maxSteps - left;
+    if (result == STEP_HALT) return RUN_HALTED;
+    if (result == STEP_ERROR) return RUN_FAULT;
+    return RUN_STEP_LIMIT;
+}
+
+// ไฟล์ checkpoint (binary, little-endian 32 บิตต่อค่า):
+//   "LC2K" | version | pc | instrCount (2 word) | numMemory | reg[8] | usedWords | mem[0..usedWords)
+// usedWords = ตำแหน่งของ word สุดท้ายที่ไม่เป็นศูนย์ + 1 จึงไม่ต้องเก็บ memory ว่างทั้ง 64K word
+// (ตำแหน่งการอ่านของ input device ไม่ได้เก็บไว้ในไฟล์นี้)
+const uint32_t CHECKPOINT_MAGIC = 0x4B32434C;     // "LC2K"
+const uint32_t CHECKPOINT_VERSION = 1;
+
+void putWord(ostream &out, uint32_t word) {
+    char bytes[4] = {(char)word, (char)(word >> 8), (char)(word >> 16), (char)(word >> 24)};
+    out.write(bytes, 4);
+}
+
+bool getWord(istream &in, uint32_t &word) {
+    unsigned char bytes[4];
+    if (!in.read((char *)bytes, 4)) return false;
+    word = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return true;
+}
+
+// เขียน/อ่าน checkpoint ผ่าน stream (ใช้กับไฟล์หรือ buffer ในหน่วยความจำก็ได้)
+bool saveState(const State &state, long long instrCount, ostream &out) {
+    int used = NUMMEMORY;
+    while (used > 0 && state.mem[used - 1] == 0) used--;
+
+    putWord(out, CHECKPOINT_MAGIC);
+    putWord(out, CHECKPOINT_VERSION);
+    putWord(out, state.pc);
+    putWord(out, (uint32_t)instrCount);
+    putWord(out, (uint32_t)((unsigned long long)instrCount >> 32));
+    putWord(out, state.numMemory);
+    for (int i = 0; i < NUMREGS; i++) putWord(out, state.reg[i]);
+    putWord(out, used);
+    for (int i = 0; i < used; i++) putWord(out, state.mem[i]);
+    return (bool)out;
+}
+
+bool restoreState(State &state, long long &instrCount, istream &in) {
+    uint32_t magic, version, pc, countLow, countHigh, numMemory, used, word;
+    if (!getWord(in, magic) || magic != CHECKPOINT_MAGIC || !getWord(in, version)
+        || version != CHECKPOINT_VERSION) {
+        cerr << "error: not a checkpoint file" << endl;
+        return false;
+    }
+    bool ok = getWord(in, pc) && getWord(in, countLow) && getWord(in, countHigh)
+           && getWord(in, numMemory);
+    state.reg = vector<int>(NUMREGS, 0);
+    for (int i = 0; ok && i < NUMREGS; i++) {
+        ok = getWord(in, word);
+        state.reg[i] = (int)word;
+    }
+    ok = ok && getWord(in, used) && used <= (uint32_t)NUMMEMORY && numMemory <= (uint32_t)NUMMEMORY;
+    state.mem.assign(NUMMEMORY, 0);
+    for (uint32_t i = 0; ok && i < used; i++) {
+        ok = getWord(in, word);
+        state.mem[i] = (int)word;
+    }
+    if (!ok) {
+        cerr << "error: truncated checkpoint" << endl;
+        return false;
+    }
+
+    state.pc = (int)pc;
+    state.numMemory = (int)numMemory;
+    instrCount = (long long)(((unsigned long long)countHigh << 32) | countLow);
+    return true;
+}
+
+bool save(const State &state, long long instrCount, const string &filename) {
+    ofstream out(filename, ios::binary);
+    if (!out.is_open()) {
+        cerr << "error: can't open file " << filename << endl;
+        return false;
+    }
+    return saveState(state, instrCount, out);
+}
+
+bool restore(State &state, long long &instrCount, const string &filename) {
+    ifstream in(filename, ios::binary);
+    if (!in.is_open()) {
+        cerr << "error: can't open file " << filename << endl;
+        return false;
+    }
+    return restoreState(state, instrCount, in);
+}
+
+void printHalt(const State &state, long long instrCount) {
+    outputDevice.flush();
+    cout << "machine halted\n";
+    cout << "total of " << instrCount << " instructions executed\n";
+    cout << "final state of machine:\n";
+    printState(state);
+}
+
+// ---------------------------------------------------------------------
+// Sampler: บันทึก pc + register ทุก N คำสั่ง หรือทุก T ms ของเวลาเครื่อง host
+// interpreter ใส่ sample ลง ring buffer แบบ lock-free (producer / consumer อย่างละ 1 thread)
+// แล้ว thread เขียนไฟล์ดึงออกไปบีบอัดและเขียนเอง interpreter จึงไม่ต้องรอ I/O เลย
+// ถ้า ring เต็ม sample นั้นจะถูกทิ้งและนับไว้ใน dropped
+// ---------------------------------------------------------------------
+
+struct Sample {
+    long long count;    // จำนวนคำสั่งที่รันไปแล้วตอนเก็บ sample
+    int pc;
+    int reg[NUMREGS];
+};
+
+const size_t SAMPLE_RING_SIZE = 1 << 12;    // ต้องเป็นกำลังของ 2
+const long long SAMPLE_CHUNK = 4096;        // โหมดเวลา: ตรวจนาฬิกาทุก ๆ กี่คำสั่ง
+
+struct SampleRing {
+    vector<Sample> slots;
+    atomic<size_t> head{0};     // ช่องถัดไปที่ writer จะอ่าน (writer เป็นคนเขียนค่านี้)
+    atomic<size_t> tail{0};     // ช่องถัดไปที่ interpreter จะใส่ (interpreter เป็นคนเขียนค่านี้)
+
+    SampleRing() : slots(SAMPLE_RING_SIZE) {}
+
+    bool push(const Sample &sample) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == SAMPLE_RING_SIZE) return false;
+        slots[t & (SAMPLE_RING_SIZE - 1)] = sample;
+        tail.store(t + 1, memory_order_release);
+        return true;
+    }
+
+    bool pop(Sample &sample) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) return false;
+        sample = slots[h & (SAMPLE_RING_SIZE - 1)];
+        head.store(h + 1, memory_order_release);
+        return true;
+    }
+};
+
+// ไฟล์ trace (binary):
+//   "LC2S" | version | every | everyMs (word ละ 32 บิต little-endian เหมือน checkpoint)
+//   ตามด้วย sample ต่อกันจนจบไฟล์ แต่ละ sample เก็บเป็นผลต่างจาก sample ก่อนหน้า:
+//   varint(จำนวนคำสั่งที่เพิ่ม) | zigzag varint(pc ที่เปลี่ยน) | zigzag varint(reg ที่เปลี่ยน) × 8
+// pc และ register ส่วนใหญ่เปลี่ยนน้อยระหว่าง sample จึงมักใช้แค่ 1 byte ต่อค่า
+const uint32_t TRACE_MAGIC = 0x5332434C;    // "LC2S"
+const uint32_t TRACE_VERSION = 1;
+
+void putVarint(string &out, uint64_t value) {
+    while (value >= 0x80) {
+        out += (char)(value | 0x80);
+        value >>= 7;
+    }
+    out += (char)value;
+}
+
+bool getVarint(istream &in, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = in.get();
+        if (byte == EOF) return false;
+        value |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// ผลต่างของค่า 32 บิต (วนรอบได้) → เลขไม่ติดลบที่ค่าใกล้ 0 มีขนาดเล็ก
+inline uint32_t zigzag(int prev, int value) {
+    int32_t delta = (int32_t)((uint32_t)value - (uint32_t)prev);
+    return ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+}
+
+inline int unzigzag(int prev, uint32_t code) {
+    uint32_t delta = (code >> 1) ^ (0u - (code & 1));
+    return (int)((uint32_t)prev + delta);
+}
+
+void encodeSample(const Sample &prev, const Sample &sample, string &out) {
+    putVarint(out, (uint64_t)(sample.count - prev.count));
+    putVarint(out, zigzag(prev.pc, sample.pc));
+    for (int i = 0; i < NUMREGS; i++) putVarint(out, zigzag(prev.reg[i], sample.reg[i]));
+}
+
+// อ่าน sample ถัดไป: sample ต้องเก็บค่าของ sample ก่อนหน้าไว้ (เริ่มต้นเป็นศูนย์ทั้งหมด)
+bool decodeSample(istream &in, Sample &sample) {
+    uint64_t value;
+    if (!getVarint(in, value)) return false;
+    sample.count += (long long)value;
+    if (!getVarint(in, value)) return false;
+    sample.pc = unzigzag(sample.pc, (uint32_t)value);
+    for (int i = 0; i < NUMREGS; i++) {
+        if (!getVarint(in, value)) return false;
+        sample.reg[i] = unzigzag(sample.reg[i], (uint32_t)value);
+    }
+    return true;
+}
+
+// เปิดไฟล์ trace แล้วอ่าน header (ใช้กับ trace_report.cpp)
+bool openTrace(const string &filename, ifstream &in, uint32_t &every, uint32_t &everyMs) {
+    in.open(filename, ios::binary);
+    uint32_t magic, version;
+    if (!in.is_open() || !getWord(in, magic) || magic != TRACE_MAGIC
+        || !getWord(in, version) || version != TRACE_VERSION
+        || !getWord(in, every) || !getWord(in, everyMs)) {
+        cerr << "error: " << filename << " is not a trace file" << endl;
+        return false;
+    }
+    return true;
+}
+
+struct Sampler {
+    long long every = 0;        // เก็บทุก every คำสั่ง (0 = ใช้เวลา host แทน)
+    int everyMs = 0;            // เก็บทุก everyMs มิลลิวินาที
+    unique_ptr<SampleRing> ring;
+    ofstream file;
+    thread writer;
+    atomic<bool> done{false};
+    long long taken = 0, dropped = 0;
+};
+
+// เปิดไฟล์ trace เขียน header แล้วเริ่ม thread เขียนไฟล์
+bool startSampler(Sampler &sampler, const string &filename) {
+    sampler.file.open(filename, ios::binary);
+    if (!sampler.file.is_open()) {
+        cerr << "error: can't open file " << filename << endl;
+        return false;
+    }
+    putWord(sampler.file, TRACE_MAGIC);
+    putWord(sampler.file, TRACE_VERSION);
+    putWord(sampler.file, (uint32_t)sampler.every);
+    putWord(sampler.file, (uint32_t)sampler.everyMs);
+
+    sampler.ring.reset(new SampleRing());
+    sampler.writer = thread([&sampler]() {
+        Sample prev = {}, sample;
+        string buffer;
+        while (true) {
+            // อ่าน done ก่อนดึง sample: ถ้า done แล้ว sample ทุกตัวอยู่ใน ring แล้วแน่นอน
+            bool finished = sampler.done.load(memory_order_acquire);
+            bool idle = true;
+            while (sampler.ring->pop(sample)) {
+                encodeSample(prev, sample, buffer);
+                prev = sample;
+                idle = false;
+            }
+            if (buffer.size() >= (1 << 16) || finished) {
+                sampler.file.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+            if (finished) break;
+            if (idle) this_thread::sleep_for(chrono::milliseconds(1));    // ring ว่าง ค่อยกลับมาดูใหม่
+        }
+    });
+    return true;
+}
+
+void stopSampler(Sampler &sampler) {
+    sampler.done.store(true, memory_order_release);
+    sampler.writer.join();
+    sampler.file.close();
+    cerr << "sampler: " << sampler.taken - sampler.dropped << " samples written, "
+         << sampler.dropped << " dropped (ring full)" << endl;
+}
+
+inline void takeSample(Sampler &sampler, const State &state, long long instrCount) {
+    Sample sample;
+    sample.count = instrCount;
+    sample.pc = state.pc;
+    copy(state.reg.begin(), state.reg.end(), sample.reg);
+    sampler.taken++;
+    if (!sampler.ring->push(sample)) sampler.dropped++;
+}
+
+// รันเหมือน run() แต่แบ่งเป็นช่วง ช่วงละ every คำสั่ง (โหมดเวลา: ช่วงละ SAMPLE_CHUNK แล้วดูนาฬิกา)
+// loop ของแต่ละช่วงคือ run() เดิม งานเพิ่มจึงเกิดแค่ที่รอยต่อระหว่างช่วงเท่านั้น
+// maxSteps < 0 = รันจนกว่าจะ halt
+RunStatus runSampled(State &state, long long maxSteps, long long &instrCount, Sampler &sampler) {
+    long long chunk = (sampler.every > 0) ? sampler.every : SAMPLE_CHUNK;
+    long long left = (maxSteps < 0) ? LLONG_MAX : maxSteps;
+    auto period = chrono::milliseconds(max(sampler.everyMs, 1));
+    auto next = chrono::steady_clock::now() + period;
+    while (left > 0) {
+        long long n = min(chunk, left);
+        left -= n;
+        RunStatus status = run(state, n, instrCount);
+        if (status != RUN_STEP_LIMIT) return status;
+
+        if (sampler.every > 0) {
+            takeSample(sampler, state, instrCount);
+        } else {
+            auto now = chrono::steady_clock::now();
+            if (now >= next) {
+                takeSample(sampler, state, instrCount);
+                next = now + period;
+            }
+        }
+    }
+    return RUN_STEP_LIMIT;
+}
+
+// ---------------------------------------------------------------------
+// Debugger
+// ---------------------------------------------------------------------
+
+struct Debugger {
+    vector<uint64_t> breakBits;     // bitmap ของ pc ที่มี breakpoint (1 bit ต่อ address)
+    vector<uint64_t> watchBits;     // bitmap ของ memory word ที่มี watchpoint
+    int breakCount = 0;
+    int watchCount = 0;
+    map<string, int> symbols;       // label → address (อ่านจากไฟล์ .sym)
+    map<int, string> labels;        // address → label (ใช้ตอน disassemble)
+
+    Debugger() : breakBits(NUMMEMORY / 64, 0), watchBits(NUMMEMORY / 64, 0) {}
+};
+
+inline bool testBit(const vector<uint64_t> &bits, int addr) {
+    return (bits[addr >> 6] >> (addr & 63)) & 1;
+}
+
+// ตั้ง/ลบ bit แล้วคืนค่าว่าสถานะเปลี่ยนหรือไม่ (ไว้นับจำนวน breakpoint)
+bool setBit(vector<uint64_t> &bits, int addr, bool on) {
+    bool old = testBit(bits, addr);
+    if (on) bits[addr >> 6] |= (uint64_t)1 << (addr & 63);
+    else    bits[addr >> 6] &= ~((uint64_t)1 << (addr & 63));
+    return old != on;
+}
+
+// อ่านไฟล์ symbol map ที่ assembler เขียนไว้ ถ้าไม่มีไฟล์ก็ใช้งานได้แต่ไม่มีชื่อ label
+void loadSymbols(const string &filename, Debugger &dbg) {
+    ifstream file(filename);
+    if (!file.is_open()) return;
+
+    string name;
+    int addr;
+    while (file >> name >> addr) {
+        dbg.symbols[name] = addr;
+        dbg.labels[addr] = name;
+    }
+}
+
+// แปลง argument ที่ผู้ใช้พิมพ์ (ตัวเลขหรือชื่อ label) เป็น address
+// คืนค่า -1 ถ้าไม่รู้จัก
+int resolveAddress(const Debugger &dbg, const string &arg) {
+    if (arg.empty()) return -1;
+    char *p;
+    long value = strtol(arg.c_str(), &p, 10);
+    if (*p == 0) return (value >= 0 && value < NUMMEMORY) ? (int)value : -1;
+    auto it = dbg.symbols.find(arg);
+    return (it == dbg.symbols.end()) ? -1 : it->second;
+}
+
+string addressName(const Debugger &dbg, int addr) {
+    auto it = dbg.labels.find(addr);
+    return (it == dbg.labels.end()) ? to_string(addr) : it->second;
+}
+
+// แปลง machine code 1 word กลับเป็นรูปแบบ assembly
+// word ที่มีบิตเกิน 25 บิต (เช่นค่าติดลบ) ไม่ใช่คำสั่งแน่นอน จึงแสดงเป็น .fill
+string disassemble(const Debugger &dbg, int instr, int pc) {
+    static const char *NAMES[] = {"add", "nand", "lw", "sw", "beq", "jalr", "halt", "noop"};
+    if (instr & ~0x1FFFFFF) return ".fill " + to_string(instr);
+
+    int opcode = (instr >> 22) & 0x7;
+    int regA = (instr >> 19) & 0x7;
+    int regB = (instr >> 16) & 0x7;
+    int offset = convertNum(instr & 0xFFFF);
+
+    stringstream out;
+    out << NAMES[opcode];
+    switch (opcode) {
+        case 0: case 1:
+            out << " " << regA << " " << regB << " " << (instr & 0x7);
+            break;
+        case 2: case 3:
+            // offset ที่ตรงกับ address ของ label แสดงเป็นชื่อ label (เช่น sw 5 7 stack ที่ base เป็น stack pointer)
+            out << " " << regA << " " << regB << " ";
+            if (dbg.labels.count(offset)) out << dbg.labels.at(offset);
+            else out << offset;
+            break;
+        case 4: {
+            int target = pc + 1 + offset;
+            out << " " << regA << " " << regB << " ";
+            if (dbg.labels.count(target)) out << dbg.labels.at(target);
+            else out << offset;
+            break;
+        }
+        case 5:
+            out << " " << regA << " " << regB;
+            break;
+        case 7:
+            if (instr & 0x3FFFFF)
+                return "swap " + to_string(regA) + " " + to_string(regB) + " "
+                     + (dbg.labels.count(offset) ? dbg.labels.at(offset) : to_string(offset));
+            break;
+    }
+    return out.str();
+}
+
+void printLocation(const Debugger &dbg, const State &state, int addr) {
+    if (addr < 0 || addr >= NUMMEMORY) {
+        cout << "  " << addr << "\tpc out of bounds\n";
+        return;
+    }
+    string label = dbg.labels.count(addr) ? dbg.labels.at(addr) : "";
+    cout << "  " << addr << "\t" << label << "\t" << disassemble(dbg, state.mem[addr], addr) << "\n";
+}
+
+// loop ของ debugger: ตรวจ bitmap breakpoint และ watchpoint ก่อนทุกคำสั่ง
+// skipFirst ใช้ตอน continue/step ต่อจาก breakpoint เดิม เพื่อไม่ให้หยุดซ้ำที่ pc เดิม
+StepResult runDebug(State &state, Debugger &dbg, long long &instrCount, long long maxSteps, bool skipFirst) {
+    for (long long n = 0; maxSteps < 0 || n < maxSteps; n++) {
+        if (state.pc >= 0 && state.pc < NUMMEMORY) {
+            if (!(skipFirst && n == 0) && dbg.breakCount && testBit(dbg.breakBits, state.pc)) {
+                cout << "breakpoint at " << addressName(dbg, state.pc) << "\n";
+                return STEP_OK;
+            }
+        }
+
+        // หา address ที่ sw จะเขียน เพื่อตรวจ watchpoint
+        int watchAddr = -1, oldValue = 0;
+        if (dbg.watchCount && state.pc >= 0 && state.pc < NUMMEMORY) {
+            int instr = state.mem[state.pc];
+            int opcode = (instr >> 22) & 0x7;
+            if (opcode == 3 || (opcode == 7 && (instr & 0x3FFFFF))) {     // sw หรือ swap
+                int addr = state.reg[(instr >> 19) & 0x7] + convertNum(instr & 0xFFFF);
+                if (addr >= 0 && addr < NUMMEMORY && testBit(dbg.watchBits, addr)) {
+                    watchAddr = addr;
+                    oldValue = state.mem[addr];
+                }
+            }
+        }
 
         instrCount++;
+        StepResult result = step(state);
+        if (result != STEP_OK) return result;
 
-        if (state.pc < 0 || state.pc >= (int)state.mem.size()) {
-            cerr << "error: pc out of bounds" << endl;
-            return 1;
+        if (watchAddr >= 0 && state.mem[watchAddr] != oldValue) {
+            cout << "watchpoint " << addressName(dbg, watchAddr) << ": "
+                 << oldValue << " -> " << state.mem[watchAddr] << "\n";
+            return STEP_OK;
         }
+    }
+    return STEP_OK;
+}
+
+void printDebugHelp() {
+    cout << "commands:\n"
+         << "  b <pc|label>        set breakpoint\n"
+         << "  d <pc|label>        delete breakpoint\n"
+         << "  w <addr|label>      set watchpoint on memory word\n"
+         << "  uw <addr|label>     delete watchpoint\n"
+         << "  s [n]               step n instructions (default 1)\n"
+         << "  c                   continue until breakpoint/watchpoint/halt\n"
+         << "  r                   print registers\n"
+         << "  m <addr|label> [n]  print n memory words\n"
+         << "  x [addr|label] [n]  disassemble n words (default at pc)\n"
+         << "  l                   list breakpoints and watchpoints\n"
+         << "  q                   quit\n";
+}
+
+// REPL ของ debugger
+int debugger(const string &filename) {
+    State state;
+    if (!loadProgram(filename, state)) return 1;
+
+    Debugger dbg;
+    loadSymbols(symbolFileName(filename), dbg);
+
+    long long instrCount = 0;
+    bool halted = false;
+    bool atBreak = false;   // pc ปัจจุบันเป็นจุดที่เพิ่งหยุดเพราะ breakpoint
+
+    cout << "loaded " << state.numMemory << " words, " << dbg.symbols.size() << " symbols\n";
+    printDebugHelp();
 
-        int instr = state.mem[state.pc];
-        int opcode = (instr >> 22) & 0x7;
-        int regA = (instr >> 19) & 0x7;
-        int regB = (instr >> 16) & 0x7;
-        int offset = convertNum(instr & 0xFFFF);
-
-        switch (opcode) {
-            case 0: // add
-                state.reg[instr & 0x7] = state.reg[regA] + state.reg[regB];
-                state.pc++;
-                break;
-            case 1: // nand
-                state.reg[instr & 0x7] = ~(state.reg[regA] & state.reg[regB]);
-                state.pc++;
-                break;
-            case 2: // lw
-                state.reg[regB] = state.mem[state.reg[regA] + offset];
-                state.pc++;
-                break;
-            case 3: // sw
-                state.mem[state.reg[regA] + offset] = state.reg[regB];
-                state.pc++;
-                break;
-            case 4: // beq
-                if (state.reg[regA] == state.reg[regB])
-                    state.pc = state.pc + 1 + offset;
-                else
-                    state.pc++;
-                break;
-            case 5: { // jalr
-                int temp = state.pc + 1;
-                state.pc = state.reg[regA];
-                state.reg[regB] = temp;
-                break;
+    string line;
+    while (cout << "(dbg) " << flush, getline(cin, line)) {
+        stringstream ss(line);
+        string cmd, arg0, arg1;
+        ss >> cmd >> arg0 >> arg1;
+        if (cmd.empty()) continue;
+
+        if (cmd == "q") break;
+        else if (cmd == "b" || cmd == "d" || cmd == "w" || cmd == "uw") {
+            int addr = resolveAddress(dbg, arg0);
+            if (addr < 0) { cout << "unknown address " << arg0 << "\n"; continue; }
+            if (cmd == "b" || cmd == "d") {
+                if (setBit(dbg.breakBits, addr, cmd == "b")) dbg.breakCount += (cmd == "b") ? 1 : -1;
+            } else {
+                if (setBit(dbg.watchBits, addr, cmd == "w")) dbg.watchCount += (cmd == "w") ? 1 : -1;
+            }
+        }
+        else if (cmd == "s" || cmd == "c") {
+            if (halted) { cout << "machine halted\n"; continue; }
+            long long n = (cmd == "c") ? -1 : (arg0.empty() ? 1 : atoll(arg0.c_str()));
+            StepResult result;
+            // ไม่มี breakpoint/watchpoint เลย → ใช้ loop ปกติที่ไม่มีการตรวจใด ๆ
+            if (cmd == "c" && dbg.breakCount == 0 && dbg.watchCount == 0)
+                result = runFast(state, instrCount);
+            else
+                result = runDebug(state, dbg, instrCount, n, atBreak);
+            atBreak = (result == STEP_OK && state.pc >= 0 && state.pc < NUMMEMORY
+                       && testBit(dbg.breakBits, state.pc));
+            if (result == STEP_HALT) {
+                halted = true;
+                printHalt(state, instrCount);
+            } else if (result == STEP_ERROR) {
+                halted = true;
+                printFaultLocation(filename, state.pc);
+            } else {
+                printLocation(dbg, state, state.pc);
+            }
+        }
+        else if (cmd == "r") {
+            cout << "  pc " << state.pc << "\n";
+            for (int i = 0; i < NUMREGS; i++)
+                cout << "  reg[ " << i << " ] " << state.reg[i] << "\n";
+        }
+        else if (cmd == "m") {
+            int addr = resolveAddress(dbg, arg0);
+            if (addr < 0) { cout << "unknown address " << arg0 << "\n"; continue; }
+            int n = arg1.empty() ? 1 : atoi(arg1.c_str());
+            for (int i = addr; i < addr + n && i < NUMMEMORY; i++)
+                cout << "  mem[ " << addressName(dbg, i) << " ] " << state.mem[i] << "\n";
+        }
+        else if (cmd == "x") {
+            int addr = arg0.empty() ? state.pc : resolveAddress(dbg, arg0);
+            if (arg0.empty() && (addr < 0 || addr >= NUMMEMORY)) { cout << "pc out of bounds\n"; continue; }
+            if (addr < 0) { cout << "unknown address " << arg0 << "\n"; continue; }
+            int n = arg1.empty() ? 5 : atoi(arg1.c_str());
+            for (int i = addr; i < addr + n && i < NUMMEMORY; i++)
+                printLocation(dbg, state, i);
+        }
+        else if (cmd == "l") {
+            for (int i = 0; i < NUMMEMORY; i++) {
+                if (testBit(dbg.breakBits, i)) cout << "  break " << addressName(dbg, i) << "\n";
+                if (testBit(dbg.watchBits, i)) cout << "  watch " << addressName(dbg, i) << "\n";
+            }
+        }
+        else printDebugHelp();
+    }
+    outputDevice.flush();
+    return 0;
+}
+
+// ---------------------------------------------------------------------
+// Multi-core: หลาย core ใช้ memory ร่วมกัน แต่ละ core มี pc และ register ของตัวเอง
+// ---------------------------------------------------------------------
+
+struct Core {
+    int id;
+    int pc;
+    vector<int> reg;
+    long long instrCount;
+    StepResult status;      // STEP_OK = ยังรันอยู่
+};
+
+void printCores(const vector<Core> &cores) {
+    for (const Core &core : cores) {
+        cout << "core " << core.id << ": "
+             << (core.status == STEP_HALT ? "halted" : "error")
+             << " after " << core.instrCount << " instructions, pc " << core.pc << "\n";
+        for (int i = 0; i < NUMREGS; i++)
+            cout << "\t\treg[ " << i << " ] " << core.reg[i] << "\n";
+    }
+}
+
+// รันทุก core แบบ round-robin: core ละ quantum คำสั่งต่อรอบ เรียงตามหมายเลข core
+// ลำดับการเข้าถึง memory จึงเหมือนเดิมทุกครั้ง (deterministic)
+void runRoundRobin(vector<Core> &cores, vector<int> &mem, int quantum) {
+    int running = (int)cores.size();
+    while (running > 0) {
+        for (Core &core : cores) {
+            if (core.status != STEP_OK) continue;
+            for (int n = 0; n < quantum; n++) {
+                core.instrCount++;
+                core.status = execute(core.pc, core.reg, mem, core.id);
+                if (core.status != STEP_OK) {
+                    running--;
+                    break;
+                }
             }
-            case 6: // halt
-                cout << "machine halted\n";
-                cout << "total of " << instrCount << " instructions executed\n";
-                cout << "final state of machine:\n";
-                printState(state);
-                return 0;
-            case 7: // noop
-                state.pc++;
-                break;
-            default:
-                cerr << "error: invalid opcode " << opcode << endl;
-                return 1;
         }
     }
 }
 
-int main() {
-    simulator("machine_code/machine_code.txt");
+// รันแต่ละ core บน host thread ของตัวเอง memory ทุก word เป็น atomic
+// ลำดับการ interleave ขึ้นกับ OS จึงไม่ deterministic แต่ swap ยังคง atomic
+void runParallel(vector<Core> &cores, vector<atomic<int>> &mem) {
+    vector<thread> threads;
+    for (Core &core : cores) {
+        threads.emplace_back([&core, &mem]() {
+            do {
+                core.instrCount++;
+                core.status = execute(core.pc, core.reg, mem, core.id);
+            } while (core.status == STEP_OK);
+        });
+    }
+    for (thread &t : threads) t.join();
+}
+
+int multiCoreSimulator(const string &filename, int numCores, int quantum, bool parallel) {
+    State state;
+    if (!loadProgram(filename, state)) return 1;
+
+    vector<Core> cores;
+    for (int i = 0; i < numCores; i++)
+        cores.push_back({i, 0, vector<int>(NUMREGS, 0), 0, STEP_OK});
+
+    auto start = chrono::steady_clock::now();
+    if (parallel) {
+        vector<atomic<int>> shared(NUMMEMORY);
+        for (int i = 0; i < NUMMEMORY; i++) shared[i].store(state.mem[i], memory_order_relaxed);
+        runParallel(cores, shared);
+        for (int i = 0; i < NUMMEMORY; i++) state.mem[i] = shared[i].load(memory_order_relaxed);
+    } else {
+        runRoundRobin(cores, state.mem, quantum);
+    }
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    outputDevice.flush();
+
+    long long total = 0;
+    for (const Core &core : cores) total += core.instrCount;
+    cout << numCores << " cores " << (parallel ? "(parallel)" : "(round-robin)") << " halted\n";
+    cout << "total of " << total << " instructions executed in " << elapsed << " ms\n";
+    printCores(cores);
+    for (const Core &core : cores)
+        if (core.status == STEP_ERROR) {
+            cerr << "core " << core.id << " fault:" << endl;
+            printFaultLocation(filename, core.pc);
+        }
+
+    // แสดง memory ที่แชร์กันในรูปแบบเดียวกับ printState (pc/reg ของ core 0)
+    state.pc = cores[0].pc;
+    state.reg = cores[0].reg;
+    printState(state);
+
+    for (const Core &core : cores)
+        if (core.status != STEP_HALT) return 1;
     return 0;
 }
+
+// ---------------------------------------------------------------------
+
+// maxSteps < 0 = รันจนกว่าจะ halt
+// ถ้าระบุ restoreFile จะเริ่มจาก checkpoint แทนไฟล์ machine code
+// ถ้าครบ maxSteps แล้วยังไม่ halt และระบุ saveFile จะบันทึก checkpoint ไว้รันต่อภายหลัง
+// ถ้าระบุ sampler จะเก็บ sample ระหว่างรัน (ดู runSampled)
+// คืนค่า 0 = halt, 1 = fault, 2 = ครบจำนวนคำสั่ง
+int simulator(const string &filename, long long maxSteps = -1,
+              const string &saveFile = "", const string &restoreFile = "",
+              Sampler *sampler = nullptr) {
+    State state;
+    long long instrCount = 0;
+    if (!restoreFile.empty()) {
+        if (!restore(state, instrCount, restoreFile)) return 1;
+    } else if (!loadProgram(filename, state)) {
+        return 1;
+    }
+
+    if (maxSteps < 0 && !sampler) {
+        if (runFast(state, instrCount) != STEP_HALT) {
+            outputDevice.flush();
+            printFaultLocation(filename, state.pc);
+            return 1;
+        }
+        printHalt(state, instrCount);
+        return 0;
+    }
+
+    RunStatus status = sampler ? runSampled(state, maxSteps, instrCount, *sampler)
+                               : run(state, maxSteps, instrCount);
+    if (status == RUN_HALTED) {
+        printHalt(state, instrCount);
+        return 0;
+    }
+    outputDevice.flush();
+    if (status == RUN_FAULT) {
+        printFaultLocation(filename, state.pc);
+        return 1;
+    }
+
+    cout << "step limit reached: total of " << instrCount << " instructions executed, pc "
+         << state.pc << "\n";
+    if (!saveFile.empty()) {
+        if (!save(state, instrCount, saveFile)) return 1;
+        cout << "checkpoint saved to " << saveFile << "\n";
+    }
+    return 2;
+}
+
+// เครื่องมืออื่น (เช่น fuzzer.cpp) #include ไฟล์นี้ได้โดย #define SIMULATOR_NO_MAIN ก่อน
+#ifndef SIMULATOR_NO_MAIN
+// ใช้งาน: simulator_2 [machine_code.txt] [-d] [-c N [-q quantum] [-p]] [-i input] [-o output]
+//                    [-n steps] [-save file] [-restore file] [-sample N | -sample-ms T] [-trace file]
+// -d = เปิด debugger แบบโต้ตอบ (breakpoint / watchpoint / step)
+// -c = รันแบบหลาย core (N core แชร์ memory) สลับกัน core ละ quantum คำสั่ง (ค่าเริ่มต้น 100)
+// -p = ให้แต่ละ core รันบน thread ของตัวเองพร้อมกันจริง (คอมไพล์ด้วย -pthread)
+// -i / -o = ไฟล์ของ input/output device ("-" = stdin/stdout, output ค่าเริ่มต้นคือ stdout)
+// -n = รันไม่เกิน steps คำสั่ง, -save = บันทึก checkpoint เมื่อครบ, -restore = รันต่อจาก checkpoint
+// -sample / -sample-ms = เก็บ pc + register ทุก N คำสั่ง / ทุก T ms ลงไฟล์ -trace
+//   (ค่าเริ่มต้น machine_code.trace ข้างไฟล์ machine code) แล้วดูผลด้วย trace_report
+int main(int argc, char *argv[]) {
+    string filename = "machine_code/machine_code.txt";
+    string inputFile, outputFile, saveFile, restoreFile;
+    bool debug = false, parallel = false;
+    int numCores = 0, quantum = 100;
+    long long maxSteps = -1;
+    Sampler sampler;
+    string traceFile;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-d") debug = true;
+        else if (arg == "-p") parallel = true;
+        else if (arg == "-c" && i + 1 < argc) numCores = atoi(argv[++i]);
+        else if (arg == "-q" && i + 1 < argc) quantum = atoi(argv[++i]);
+        else if (arg == "-i" && i + 1 < argc) inputFile = argv[++i];
+        else if (arg == "-o" && i + 1 < argc) outputFile = argv[++i];
+        else if (arg == "-n" && i + 1 < argc) maxSteps = atoll(argv[++i]);
+        else if (arg == "-save" && i + 1 < argc) saveFile = argv[++i];
+        else if (arg == "-restore" && i + 1 < argc) restoreFile = argv[++i];
+        else if (arg == "-sample" && i + 1 < argc) sampler.every = max(1LL, atoll(argv[++i]));
+        else if (arg == "-sample-ms" && i + 1 < argc) sampler.everyMs = max(1, atoi(argv[++i]));
+        else if (arg == "-trace" && i + 1 < argc) traceFile = argv[++i];
+        else filename = arg;
+    }
+
+    if (!openDevices(inputFile, outputFile)) return 1;
+    if (debug) return debugger(filename);
+    if (numCores > 0) return multiCoreSimulator(filename, numCores, max(quantum, 1), parallel);
+    if (sampler.every > 0 || sampler.everyMs > 0 || !traceFile.empty()) {
+        if (sampler.every == 0 && sampler.everyMs == 0) sampler.every = 1000000;
+        if (!startSampler(sampler, traceFile.empty() ? sideFileName(filename, ".trace") : traceFile))
+            return 1;
+        int result = simulator(filename, maxSteps, saveFile, restoreFile, &sampler);
+        stopSampler(sampler);
+        return result;
+    }
+    return simulator(filename, maxSteps, saveFile, restoreFile);
+}
+#endif
@@ -0,0 +1,189 @@
+// Simulator ที่ specialize ตอนคอมไพล์สำหรับโปรแกรมตายตัว (เช่น Multiplication.txt)
+// machine code ถูกฝังเป็น constexpr std::array ใน header แล้ว interpreter เป็น template บน image นั้น
+// ทุก field ของทุกคำสั่งจึงเป็นค่าคงที่ตอนคอมไพล์ และคำสั่งที่ต่อกันตรง ๆ จะถูกรวมเป็น block เดียว
+//
+// สร้าง header และคอมไพล์ (แทน build target):
+//   g++ -O2 assembler_2.cpp -o assembler_2
+//   ./assembler_2 -H machine_code/program.h assembly/Multiplication.txt machine_code/machine_code.txt
+//   g++ -O2 -std=c++17 -pthread specialized_simulator.cpp -o specialized_simulator
+//   ./specialized_simulator [repeat]      (benchmark เทียบกับ runFast() ที่ simulator() ของ simulator_2 ใช้)
+//
+// ข้อจำกัด: โปรแกรมต้องไม่เขียนทับคำสั่งของตัวเอง (sw ลงข้อมูล .fill ได้ตามปกติ)
+#define SIMULATOR_NO_MAIN
+#include "simulator_2.cpp"
+
+#include <array>
+#include <utility>
+#include <climits>
+
+#ifndef PROGRAM_HEADER
+#define PROGRAM_HEADER "machine_code/program.h"
+#endif
+#include PROGRAM_HEADER
+
+// ค่าที่ block คืนแทน pc ถัดไป เมื่อเครื่องหยุด
+const int SPEC_HALT = INT_MIN;
+const int SPEC_FAULT = INT_MIN + 1;
+
+// จำนวนคำสั่งสูงสุดที่รวมเป็น block เดียว (กันโค้ดโตเกินไป)
+const int MAX_FUSED = 16;
+
+constexpr int signExtend16(int num) {
+    return (num & (1 << 15)) ? num - (1 << 16) : num;
+}
+
+// รันคำสั่งที่ PC แล้วรันคำสั่งถัดไปต่อใน block เดียวกันถ้าไม่ใช่ branch
+// คืนค่า pc ถัดไปเมื่อ control flow ไม่แน่นอนตอนคอมไพล์ (beq ที่กระโดด, jalr) หรือครบ MAX_FUSED
+template <const auto &P, int PC, int Depth>
+int runBlock(State &state, long long &instrCount) {
+    constexpr int N = (int)P.size();
+    constexpr int instr = P[PC];
+    constexpr int opcode = (instr >> 22) & 0x7;
+    constexpr int regA = (instr >> 19) & 0x7;
+    constexpr int regB = (instr >> 16) & 0x7;
+    constexpr int destReg = instr & 0x7;
+    constexpr int offset = signExtend16(instr & 0xFFFF);
+    constexpr bool fuseNext = (PC + 1 < N) && (Depth + 1 < MAX_FUSED);
+
+    int *reg = state.reg.data();
+    instrCount++;
+
+    if constexpr (opcode == 6) {            // halt
+        state.pc = PC;
+        return SPEC_HALT;
+    } else if constexpr (opcode == 5) {     // jalr
+        reg[regB] = PC + 1;
+        return reg[regA];
+    } else if constexpr (opcode == 4) {     // beq
+        if (reg[regA] == reg[regB]) return PC + 1 + offset;
+    } else if constexpr (opcode == 0) {     // add
+        reg[destReg] = reg[regA] + reg[regB];
+    } else if constexpr (opcode == 1) {     // nand
+        reg[destReg] = ~(reg[regA] & reg[regB]);
+    } else if constexpr (opcode == 2 || opcode == 3 || (opcode == 7 && (instr & 0x3FFFFF))) {
+        // lw / sw / swap: address ขึ้นกับ register จึงต้องตรวจตอนรัน (ทาง device เหมือน execute())
+        int addr = reg[regA] + offset;
+        if ((unsigned)addr >= (unsigned)IO_BASE) {
+            bool ok = false;
+            if constexpr (opcode == 2) ok = deviceLoad(addr, 0, reg[regB]);
+            else if constexpr (opcode == 3) ok = deviceStore(addr, reg[regB]);
+            else cerr << "error: swap on device address" << endl;
+            if (!ok) {
+                state.pc = PC;
+                return SPEC_FAULT;
+            }
+        } else if constexpr (opcode == 2) {
+            reg[regB] = state.mem[addr];
+        } else if constexpr (opcode == 3) {
+            state.mem[addr] = reg[regB];
+        } else {
+            reg[regB] = exchangeWord(state.mem[addr], reg[regB]);
+        }
+    }
+
+    if constexpr (fuseNext) return runBlock<P, PC + 1, Depth + 1>(state, instrCount);
+    else return PC + 1;
+}
+
+// ตาราง entry ของ block สำหรับทุก pc ในโปรแกรม (สร้างตอนคอมไพล์)
+using BlockFn = int (*)(State &, long long &);
+
+template <const auto &P, size_t... I>
+constexpr array<BlockFn, sizeof...(I)> makeBlockTable(index_sequence<I...>) {
+    return {{&runBlock<P, (int)I, 0>...}};
+}
+
+// รันโปรแกรม P จนกว่าจะ halt หรือ fault; pc ที่อยู่นอก image ใช้ step() ปกติ
+template <const auto &P>
+RunStatus runSpecialized(State &state, long long &instrCount) {
+    static constexpr auto table = makeBlockTable<P>(make_index_sequence<P.size()>());
+    int pc = state.pc;
+    while (true) {
+        if ((unsigned)pc < P.size()) {
+            pc = table[pc](state, instrCount);
+            if (pc == SPEC_HALT) return RUN_HALTED;
+            if (pc == SPEC_FAULT) return RUN_FAULT;
+        } else {
+            state.pc = pc;
+            instrCount++;
+            StepResult result = step(state);
+            if (result == STEP_HALT) return RUN_HALTED;
+            if (result == STEP_ERROR) return RUN_FAULT;
+            pc = state.pc;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------
+// Benchmark: รันโปรแกรมเดิมซ้ำ repeat ครั้งด้วย run() ของ simulator_2 และด้วย runSpecialized
+// ---------------------------------------------------------------------
+
+// คืน memory ให้เหมือนตอนเริ่ม เฉพาะช่วงที่โปรแกรมเขียนถึง (dirty) เพื่อไม่ต้อง copy 64K word ทุกรอบ
+void resetState(State &state, const vector<int> &image, int dirty) {
+    state.pc = 0;
+    fill(state.reg.begin(), state.reg.end(), 0);
+    copy(image.begin(), image.end(), state.mem.begin());
+    fill(state.mem.begin() + image.size(), state.mem.begin() + dirty, 0);
+}
+
+int main(int argc, char *argv[]) {
+    long long repeat = (argc > 1) ? atoll(argv[1]) : 200000;
+    vector<int> image(PROGRAM.begin(), PROGRAM.end());
+
+    // รันครั้งแรกด้วย simulator_2 เพื่อหาผลที่ถูกต้องและช่วง memory ที่ถูกเขียน
+    // output ของรอบนี้เท่านั้นที่ออก output device รอบที่จับเวลาเก็บไว้เทียบอย่างเดียว
+    State expected;
+    load(expected, image);
+    long long expectedCount = 0;
+    vector<int> expectedOutput, output;
+    capturedOutput = &expectedOutput;
+    StepResult expectedResult = runFast(expected, expectedCount);
+    capturedOutput = &output;
+    for (int value : expectedOutput) outputDevice.put(value);
+    outputDevice.flush();
+    if (expectedResult != STEP_HALT) {
+        cerr << "error: program does not halt" << endl;
+        return 1;
+    }
+    int dirty = NUMMEMORY;
+    while (dirty > (int)image.size() && expected.mem[dirty - 1] == 0) dirty--;
+
+    State state;
+    load(state, image);
+    long long count = 0;
+
+    auto start = chrono::steady_clock::now();
+    for (long long n = 0; n < repeat; n++) {
+        resetState(state, image, dirty);
+        output.clear();
+        runFast(state, count);
+    }
+    double runtimeSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (long long n = 0; n < repeat; n++) {
+        resetState(state, image, dirty);
+        output.clear();
+        runSpecialized<PROGRAM>(state, count);
+    }
+    double specializedSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // ตรวจว่าผลของรอบสุดท้ายตรงกับ simulator_2
+    if (state.pc != expected.pc || state.reg != expected.reg || state.mem != expected.mem
+        || count != 2 * repeat * expectedCount || output != expectedOutput) {
+        cerr << "error: specialized result differs from simulator_2" << endl;
+        return 1;
+    }
+
+    double instructions = (double)repeat * expectedCount;
+    cout << PROGRAM.size() << " words, " << expectedCount << " instructions per run, "
+         << repeat << " runs\n";
+    cout << "simulator() runFast(): " << runtimeSeconds << " s, "
+         << runtimeSeconds * 1e9 / instructions << " ns/instruction\n";
+    cout << "specialized:           " << specializedSeconds << " s, "
+         << specializedSeconds * 1e9 / instructions << " ns/instruction\n";
+    cout << "speedup " << runtimeSeconds / specializedSeconds << "x\n";
+    expected.numMemory = (int)image.size();
+    printState(expected);
+    return 0;
+}
@@ -0,0 +1,228 @@
+// Parameter sweep: รันโปรแกรมเดียวกันหลายชุดค่า input (.fill) พร้อมกันบนทุก core ของเครื่อง
+// ใช้ machine code และไฟล์ symbol map (.sym) ที่ assembler เขียนไว้ ไม่ต้อง assemble ใหม่ทุกชุดค่า
+//
+// คอมไพล์: g++ -O2 -pthread sweep.cpp -o sweep
+// ใช้งาน:  sweep machine_code.txt label=ค่า [label=ค่า ...] [-j threads] [-n maxsteps] [-o results.csv]
+//   ค่าเขียนได้เป็น start:end (ทีละ 1), start:end:step หรือ a,b,c
+//   เช่น  sweep machine_code/machine_code.txt mcand=0:100 mplier=1,7,10383 -o mul.csv
+//   ทุกชุดค่าใน grid (ผลคูณคาร์ทีเซียนของทุก label) เป็น 1 job
+//   ค่าที่ job sw ไปที่ output device (65534) อยู่ในคอลัมน์ output ของ job นั้น (คั่นด้วยช่องว่าง)
+#define SIMULATOR_NO_MAIN
+#include "simulator_2.cpp"
+
+#include <memory>
+
+// memory แบบ copy-on-write: image ร่วมกันทุก job (อ่านอย่างเดียว)
+// job จะ copy เฉพาะ page ที่ตัวเองเขียนถึงเท่านั้น
+const int PAGE_BITS = 8;
+const int PAGE_SIZE = 1 << PAGE_BITS;      // 256 word ต่อ page
+const int NUMPAGES = NUMMEMORY / PAGE_SIZE;
+
+struct CowMemory {
+    const vector<int> &base;                // image ขนาด NUMMEMORY ที่ทุก job ใช้ร่วมกัน
+    vector<unique_ptr<int[]>> pages;        // page ที่ job นี้ copy มาแล้ว (nullptr = ยังใช้ของ base)
+    int copied = 0;
+
+    explicit CowMemory(const vector<int> &image) : base(image), pages(NUMPAGES) {}
+
+    int read(int addr) const {
+        const int *page = pages[addr >> PAGE_BITS].get();
+        return page ? page[addr & (PAGE_SIZE - 1)] : base[addr];
+    }
+
+    int &write(int addr) {
+        unique_ptr<int[]> &page = pages[addr >> PAGE_BITS];
+        if (!page) {
+            page.reset(new int[PAGE_SIZE]);
+            copy(base.begin() + (addr & ~(PAGE_SIZE - 1)),
+                 base.begin() + (addr & ~(PAGE_SIZE - 1)) + PAGE_SIZE, page.get());
+            copied++;
+        }
+        return page[addr & (PAGE_SIZE - 1)];
+    }
+
+    // mem[addr] ใน execute() ได้ Ref กลับไป: อ่านเป็น int ได้ตรง ๆ ส่วนการเขียนจะ copy page ก่อน
+    struct Ref {
+        CowMemory &memory;
+        int addr;
+        operator int() const { return memory.read(addr); }
+        Ref &operator=(int value) {
+            memory.write(addr) = value;
+            return *this;
+        }
+    };
+
+    Ref operator[](int addr) { return {*this, addr}; }
+};
+
+// swap ของ execute() บน memory แบบ copy-on-write (หาเจอด้วย ADL ตอน instantiate template)
+inline int exchangeWord(CowMemory::Ref word, int value) {
+    int &slot = word.memory.write(word.addr);
+    int old = slot;
+    slot = value;
+    return old;
+}
+
+// ตัวแปรที่จะ sweep: label ใน symbol table และรายการค่าที่ต้องลอง
+struct SweepParam {
+    string label;
+    int address;
+    vector<int> values;
+};
+
+struct JobResult {
+    vector<int> inputs;
+    RunStatus status;
+    long long instrCount;
+    int pc;
+    vector<int> reg;
+    int pagesCopied;
+    vector<int> output;     // ค่าที่เขียนไปที่ output device
+};
+
+// แปลง "start:end[:step]" หรือ "a,b,c" เป็นรายการค่า
+bool parseValues(const string &text, vector<int> &values) {
+    try {
+        if (text.find(':') != string::npos) {
+            stringstream ss(text);
+            string part;
+            vector<long long> fields;
+            while (getline(ss, part, ':')) fields.push_back(stoll(part));
+            if (fields.size() < 2 || fields.size() > 3) return false;
+            long long step = (fields.size() == 3) ? fields[2] : 1;
+            if (step <= 0) return false;
+            for (long long v = fields[0]; v <= fields[1]; v += step) values.push_back((int)v);
+        } else {
+            stringstream ss(text);
+            string part;
+            while (getline(ss, part, ',')) values.push_back(stoi(part));
+        }
+    } catch (const exception &) {
+        return false;
+    }
+    return !values.empty();
+}
+
+JobResult runJob(const vector<int> &image, const vector<SweepParam> &params,
+                 long long jobIndex, long long maxSteps) {
+    JobResult result;
+    CowMemory mem(image);
+
+    // แยก jobIndex เป็นตำแหน่งใน grid (label แรกเปลี่ยนช้าที่สุด) แล้ว patch ค่าลง memory
+    result.inputs.resize(params.size());
+    for (int p = (int)params.size() - 1; p >= 0; p--) {
+        long long n = (long long)params[p].values.size();
+        result.inputs[p] = params[p].values[jobIndex % n];
+        jobIndex /= n;
+        mem[params[p].address] = result.inputs[p];
+    }
+
+    int pc = 0;
+    vector<int> reg(NUMREGS, 0);
+    long long count = 0;
+    StepResult outcome = STEP_OK;
+    capturedOutput = &result.output;
+    while (count < maxSteps) {
+        count++;
+        outcome = execute(pc, reg, mem, 0);
+        if (outcome != STEP_OK) break;
+    }
+    capturedOutput = nullptr;
+
+    result.status = (outcome == STEP_HALT) ? RUN_HALTED : (outcome == STEP_ERROR) ? RUN_FAULT : RUN_STEP_LIMIT;
+    result.instrCount = count;
+    result.pc = pc;
+    result.reg = reg;
+    result.pagesCopied = mem.copied;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    string filename, outputFile;
+    vector<SweepParam> params;
+    vector<string> paramArgs;
+    int threads = max(1u, thread::hardware_concurrency());
+    long long maxSteps = 100000000;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+        else if (arg == "-n" && i + 1 < argc) maxSteps = atoll(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc) outputFile = argv[++i];
+        else if (arg.find('=') != string::npos) paramArgs.push_back(arg);
+        else filename = arg;
+    }
+    if (filename.empty() || paramArgs.empty()) {
+        cerr << "usage: sweep machine_code.txt label=values... [-j threads] [-n maxsteps] [-o out.csv]" << endl;
+        return 1;
+    }
+
+    // โหลด image ครั้งเดียว และหา address ของ label จาก symbol map
+    State state;
+    if (!loadProgram(filename, state)) return 1;
+    Debugger symbols;
+    loadSymbols(symbolFileName(filename), symbols);
+
+    for (const string &arg : paramArgs) {
+        SweepParam param;
+        param.label = arg.substr(0, arg.find('='));
+        if (!symbols.symbols.count(param.label)) {
+            cerr << "error: undefined label " << param.label << " in " << symbolFileName(filename) << endl;
+            return 1;
+        }
+        param.address = symbols.symbols[param.label];
+        if (!parseValues(arg.substr(arg.find('=') + 1), param.values)) {
+            cerr << "error: bad values for " << param.label << endl;
+            return 1;
+        }
+        params.push_back(param);
+    }
+
+    long long jobs = 1;
+    for (const SweepParam &param : params) jobs *= (long long)param.values.size();
+
+    // แต่ละ thread หยิบ job ถัดไปจากตัวนับร่วม ผลเก็บตามลำดับ job จึงได้ CSV เรียงเหมือนเดิมทุกครั้ง
+    const vector<int> &image = state.mem;
+    vector<JobResult> results(jobs);
+    atomic<long long> nextJob(0);
+    auto start = chrono::steady_clock::now();
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&]() {
+            for (long long job; (job = nextJob++) < jobs; )
+                results[job] = runJob(image, params, job, maxSteps);
+        });
+    }
+    for (thread &worker : workers) worker.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream csvFile;
+    if (!outputFile.empty()) {
+        csvFile.open(outputFile);
+        if (!csvFile.is_open()) {
+            cerr << "error: can't open file " << outputFile << endl;
+            return 1;
+        }
+    }
+    ostream &csv = outputFile.empty() ? cout : csvFile;
+
+    for (const SweepParam &param : params) csv << param.label << ",";
+    csv << "status,instructions,pc";
+    for (int i = 0; i < NUMREGS; i++) csv << ",r" << i;
+    csv << ",pages_copied,output\n";
+
+    static const char *STATUS[] = {"halted", "step_limit", "fault"};
+    long long totalInstructions = 0;
+    for (const JobResult &result : results) {
+        for (int value : result.inputs) csv << value << ",";
+        csv << STATUS[result.status] << "," << result.instrCount << "," << result.pc;
+        for (int value : result.reg) csv << "," << value;
+        csv << "," << result.pagesCopied << ",";
+        for (size_t i = 0; i < result.output.size(); i++) csv << (i ? " " : "") << result.output[i];
+        csv << "\n";
+        totalInstructions += result.instrCount;
+    }
+
+    cerr << jobs << " jobs, " << totalInstructions << " instructions on " << threads
+         << " threads in " << elapsed << " s" << endl;
+    return 0;
+}
@@ -0,0 +1,83 @@
+// สรุปไฟล์ trace จาก simulator_2 -sample / -sample-ms ว่าเวลาส่วนใหญ่อยู่ที่ label ไหน
+// pc ของแต่ละ sample นับให้ label ที่อยู่ใกล้ที่สุดก่อนหน้า (ใช้ symbol map .sym ของ assembler / linker)
+//
+// คอมไพล์: g++ -O2 -pthread trace_report.cpp -o trace_report
+// ใช้งาน:  trace_report trace_file [machine_code.txt] [-folded] [-r reg]
+//   ค่าเริ่มต้น: ตารางจำนวน sample ต่อ label เรียงจากมากไปน้อย
+//   -folded = เขียนแบบ "frame;frame count" หนึ่งบรรทัดต่อ stack ให้ flamegraph.pl ใช้ได้ทันที
+//   -r reg  = ใช้ register นี้เป็น return address (เช่น -r 7 ตาม jalr 6 7) เพิ่ม frame ของผู้เรียก
+//   เช่น  ./simulator_2 -sample 1000 -trace mul.trace
+//         ./trace_report mul.trace machine_code/machine_code.txt -folded | flamegraph.pl > mul.svg
+#define SIMULATOR_NO_MAIN
+#include "simulator_2.cpp"
+
+// ชื่อ label ที่ครอบ address นี้ ("label+offset" ถ้าไม่ใช่ตำแหน่งของ label พอดีจะนับรวมกับ label นั้น)
+string enclosingLabel(const Debugger &dbg, int addr) {
+    auto it = dbg.labels.upper_bound(addr);
+    if (it == dbg.labels.begin()) return to_string(addr);
+    return prev(it)->second;
+}
+
+int main(int argc, char *argv[]) {
+    string traceFile, filename = "machine_code/machine_code.txt";
+    bool folded = false;
+    int returnReg = -1;
+    vector<string> files;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-folded") folded = true;
+        else if (arg == "-r" && i + 1 < argc) returnReg = atoi(argv[++i]);
+        else files.push_back(arg);
+    }
+    if (files.empty() || returnReg >= NUMREGS) {
+        cerr << "usage: trace_report trace_file [machine_code.txt] [-folded] [-r reg]" << endl;
+        return 1;
+    }
+    traceFile = files[0];
+    if (files.size() > 1) filename = files[1];
+
+    ifstream in;
+    uint32_t every, everyMs;
+    if (!openTrace(traceFile, in, every, everyMs)) return 1;
+
+    State state;
+    if (!loadProgram(filename, state)) return 1;
+    Debugger dbg;
+    loadSymbols(symbolFileName(filename), dbg);
+
+    // นับ sample ต่อ stack (ผู้เรียก;label) และต่อ label
+    map<string, long long> stacks, byLabel;
+    Sample sample = {};
+    long long samples = 0;
+    while (decodeSample(in, sample)) {
+        string frame = enclosingLabel(dbg, sample.pc);
+        string stack = frame;
+        if (returnReg >= 0) {
+            // jalr เก็บ pc+1 ของคำสั่งที่เรียก จึงนับผู้เรียกที่ address - 1
+            int caller = sample.reg[returnReg] - 1;
+            if (caller >= 0 && caller < state.numMemory) stack = enclosingLabel(dbg, caller) + ";" + frame;
+        }
+        stacks[stack]++;
+        byLabel[frame]++;
+        samples++;
+    }
+
+    if (folded) {
+        for (const auto &entry : stacks) cout << entry.first << " " << entry.second << "\n";
+        return 0;
+    }
+
+    cout << samples << " samples, every ";
+    if (every > 0) cout << every << " instructions";
+    else cout << everyMs << " ms";
+    cout << ", last at instruction " << sample.count << "\n";
+
+    vector<pair<long long, string>> order;
+    for (const auto &entry : byLabel) order.push_back({entry.second, entry.first});
+    sort(order.rbegin(), order.rend());
+    for (const auto &entry : order) {
+        printf("%10lld  %6.2f%%  %s\n", entry.first,
+               samples ? 100.0 * entry.first / samples : 0.0, entry.second.c_str());
+    }
+    return 0;
+}